@@ -0,0 +1,98 @@
+#include "ofilep.h"
+
+#define ARENA_CHUNK (256UL << 10)
+#define ARENA_ALIGN 16
+#define ARENA_ROUND(size) (((size) + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1))
+#define ARENA_HEADER ARENA_ROUND(sizeof(t_chunk))
+
+struct                  s_chunk {
+    t_chunk             *prev;
+    size_t              size;
+};
+
+void *
+arena_alloc (t_arena *arena, size_t size) {
+
+    size = ARENA_ROUND(size);
+
+    /*
+       Allocations are carved out of the current chunk. When it's full, a new one is pushed on top of it, taken from
+       the spare ones if it's a regular one. Allocations too large for a regular chunk get a chunk of their own.
+    */
+
+    if (arena->chunk == NULL || arena->chunk->size - arena->used < size) {
+
+        t_chunk *chunk = arena->spare;
+
+        if (size <= ARENA_CHUNK && chunk != NULL) arena->spare = chunk->prev;
+        else {
+
+            const size_t capacity = size > ARENA_CHUNK ? size : ARENA_CHUNK;
+
+            if ((chunk = malloc(ARENA_HEADER + capacity)) == NULL) return NULL;
+            chunk->size = capacity;
+        }
+
+        chunk->prev = arena->chunk;
+        arena->chunk = chunk;
+        arena->used = 0;
+    }
+
+    void *ptr = (char *)arena->chunk + ARENA_HEADER + arena->used;
+
+    arena->used += size;
+    return ptr;
+}
+
+void *
+arena_grow (t_arena *arena, void *ptr, size_t size, size_t grown) {
+
+    /*
+       Allocations are never resized in place: a mark taken since could point to the chunk, or to the bytes past the
+       allocation, and growing it would move the chunk from under the mark or hand the same bytes out twice. The
+       allocation is copied instead, and the old one goes back with the rest once the arena is released.
+    */
+
+    void *copy = arena_alloc(arena, grown);
+
+    if (copy != NULL && ptr != NULL) ft_memcpy(copy, ptr, size < grown ? size : grown);
+    return copy;
+}
+
+t_mark
+arena_mark (const t_arena *arena) {
+
+    return (t_mark){.chunk = arena->chunk, .used = arena->used};
+}
+
+void
+arena_release (t_arena *arena, t_mark mark) {
+
+    /* Chunks pushed since the mark are kept aside for later if they are regular ones, large ones go right away. */
+    while (arena->chunk != mark.chunk) {
+
+        t_chunk *chunk = arena->chunk;
+
+        arena->chunk = chunk->prev;
+        if (chunk->size == ARENA_CHUNK) {
+
+            chunk->prev = arena->spare;
+            arena->spare = chunk;
+        } else free(chunk);
+    }
+
+    arena->used = mark.used;
+}
+
+void
+arena_del (t_arena *arena) {
+
+    arena_release(arena, (t_mark){0});
+    while (arena->spare != NULL) {
+
+        t_chunk *chunk = arena->spare;
+
+        arena->spare = chunk->prev;
+        free(chunk);
+    }
+}
@@ -0,0 +1,214 @@
+#include "ofilep.h"
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#define CACHE_MAX (256UL << 20)
+#define CACHE_LOW (CACHE_MAX / 4 * 3)
+#define CACHE_SETTLE 2
+#define CACHE_STALE 3600
+
+#ifdef __APPLE__
+# define st_mtim st_mtimespec
+# define st_ctim st_ctimespec
+#endif
+
+typedef struct          s_entry {
+    time_t              used;
+    off_t               size;
+    char                name[20];
+}                       t_entry;
+
+static uint64_t
+fnv1a (const char *key) {
+
+    uint64_t hash = 0xcbf29ce484222325ULL;
+
+    while (*key != '\0') hash = (hash ^ (uint8_t)*key++) * 0x100000001b3ULL;
+    return hash;
+}
+
+int
+cache_init (const char *dir) {
+
+    struct stat info;
+
+    if (mkdir(dir, 0777) == -1 && errno != EEXIST) return EXIT_FAILURE;
+    if (stat(dir, &info) == -1) return EXIT_FAILURE;
+    if (S_ISDIR(info.st_mode) == 0) return (errno = ENOTDIR), EXIT_FAILURE;
+    return access(dir, R_OK | W_OK | X_OK) == -1 ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+static int
+cache_key (const t_ofile *ofile, const t_meta *meta, t_dstr *key) {
+
+    struct stat info;
+
+    if (stat(meta->path, &info) == -1 || S_ISREG(info.st_mode) == 0) return EXIT_FAILURE;
+
+    /*
+       The key is stored at the start of each entry and compared in full, the file name is only its hash. The change
+       time is part of it as well, as it can't be set back by hand the way the modification time can.
+    */
+
+    if (key->buff != NULL) ft_dstrclr(key);
+    ft_dstrfpush(key, "%s %lu %lu %lu %ld.%ld %ld.%ld %u %s %s %s %s\n", meta->obin == FT_NM ? "nm" : "otool",
+            (unsigned long)info.st_dev, (unsigned long)info.st_ino, (unsigned long)info.st_size,
+            (long)info.st_mtim.tv_sec, (long)info.st_mtim.tv_nsec, (long)info.st_ctim.tv_sec,
+            (long)info.st_ctim.tv_nsec, (unsigned)ofile->opt, ofile->arch ? ofile->arch : "-",
+            ofile->defines ? ofile->defines : "-", match_key(ofile->match), meta->path);
+
+    /* A file that was just written could change again without its times changing, so it's not stored yet. */
+    return (time(NULL) - info.st_mtim.tv_sec < CACHE_SETTLE) ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+static void
+cache_path (const t_ofile *ofile, const char *key, t_dstr *path) {
+
+    ft_dstrfpush(path, "%s/%.16lx", ofile->cache, (unsigned long)fnv1a(key));
+}
+
+int
+cache_load (const t_ofile *ofile, const t_meta *meta, t_dstr *key, t_dstr *output) {
+
+    t_dstr      path = {0};
+    struct stat info;
+    char        *entry = NULL;
+    int         retcode = EXIT_FAILURE;
+
+    if (cache_key(ofile, meta, key) == EXIT_FAILURE) {
+
+        if (key->buff != NULL) ft_dstrclr(key);
+        return EXIT_FAILURE;
+    }
+
+    cache_path(ofile, key->buff, &path);
+
+    const int       fd = open(path.buff, O_RDONLY);
+    const size_t    keysize = ft_strlen(key->buff);
+
+    free(path.buff);
+    if (fd == -1) return EXIT_FAILURE;
+    if (fstat(fd, &info) == 0 && (size_t)info.st_size >= keysize && (entry = malloc((size_t)info.st_size + 1))) {
+
+        /* Entries are renamed into place once complete, so a short read means the entry is unusable. */
+        if (read(fd, entry, (size_t)info.st_size) == info.st_size && ft_strncmp(entry, key->buff, keysize) == 0) {
+
+            entry[info.st_size] = '\0';
+            ft_dstrfpush(output, "%s", entry + keysize);
+            futimens(fd, NULL);
+            retcode = EXIT_SUCCESS;
+        }
+    }
+
+    free(entry);
+    close(fd);
+    return retcode;
+}
+
+int
+cache_store (const t_ofile *ofile, const t_meta *meta, const t_dstr *key, const char *output) {
+
+    t_dstr  now = {0};
+    t_dstr  path = {0};
+    t_dstr  temp = {0};
+    int     retcode = EXIT_FAILURE;
+
+    /* The file must not have changed while we were reading it. */
+    if (key->buff == NULL || *key->buff == '\0' || cache_key(ofile, meta, &now) == EXIT_FAILURE
+        || ft_strequ(now.buff, key->buff) == 0) {
+
+        free(now.buff);
+        return EXIT_FAILURE;
+    }
+
+    cache_path(ofile, key->buff, &path);
+    ft_dstrfpush(&temp, "%s/.tmp.XXXXXX", ofile->cache);
+
+    /* Entries are written aside and renamed into place, so concurrent runs only ever see complete entries. */
+    const int fd = mkstemp(temp.buff);
+
+    if (fd != -1) {
+
+        const size_t keysize = ft_strlen(key->buff);
+        const size_t outsize = output ? ft_strlen(output) : 0;
+
+        if (write(fd, key->buff, keysize) == (ssize_t)keysize && write(fd, output, outsize) == (ssize_t)outsize
+            && close(fd) == 0 && rename(temp.buff, path.buff) == 0) retcode = EXIT_SUCCESS;
+        else unlink(temp.buff);
+    }
+
+    free(now.buff);
+    free(path.buff);
+    free(temp.buff);
+    return retcode;
+}
+
+static int
+entry_cmp (const void *a, const void *b) {
+
+    const t_entry *left = a;
+    const t_entry *right = b;
+
+    return (left->used > right->used) - (left->used < right->used);
+}
+
+void
+cache_evict (const char *dir) {
+
+    DIR             *stream = opendir(dir);
+    struct dirent   *dirent;
+    t_entry         *entries = NULL;
+    size_t          nentries = 0;
+    size_t          capacity = 0;
+    unsigned long   total = 0;
+    const int       fd = stream ? dirfd(stream) : -1;
+
+    if (stream == NULL) return;
+
+    /*
+       Once the cache grows past its bound, the least recently used entries go until it's back to three quarters of
+       it. Leftovers of writers that died before renaming their entry go once they are an hour old.
+    */
+
+    while ((dirent = readdir(stream)) != NULL) {
+
+        struct stat info;
+
+        if (fstatat(fd, dirent->d_name, &info, AT_SYMLINK_NOFOLLOW) == -1 || S_ISREG(info.st_mode) == 0) continue;
+        if (ft_strnequ(dirent->d_name, ".tmp.", 5)) {
+
+            if (time(NULL) - info.st_mtim.tv_sec > CACHE_STALE) unlinkat(fd, dirent->d_name, 0);
+            continue;
+        }
+
+        if (ft_strlen(dirent->d_name) != 16) continue;
+        if (nentries == capacity) {
+
+            t_entry *grown = realloc(entries, (capacity = capacity ? capacity * 2 : 256) * sizeof(t_entry));
+
+            if (grown == NULL) break;
+            entries = grown;
+        }
+
+        entries[nentries].used = info.st_mtim.tv_sec;
+        entries[nentries].size = info.st_size;
+        ft_memcpy(entries[nentries].name, dirent->d_name, 17);
+        total += (unsigned long)info.st_size;
+        nentries++;
+    }
+
+    if (total > CACHE_MAX) {
+
+        qsort(entries, nentries, sizeof(t_entry), entry_cmp);
+        for (size_t k = 0; k < nentries && total > CACHE_LOW; k++) {
+
+            if (unlinkat(fd, entries[k].name, 0) == 0 || errno == ENOENT) total -= (unsigned long)entries[k].size;
+        }
+    }
+
+    free(entries);
+    closedir(stream);
+}
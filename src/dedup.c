@@ -0,0 +1,253 @@
+#include "ofilep.h"
+#include <pthread.h>
+
+#define DEDUP_K1 0x9e3779b97f4a7c15ULL
+#define DEDUP_K2 0xc2b2ae3d27d4eb4fULL
+#define DEDUP_REPORT "%s: --dedup: %zu of %zu objects, %llu of %llu bytes skipped\n"
+
+/*
+   Identical objects print identical bodies. Objects are looked up by a 128-bit hash of their bytes, and the body
+   printed for the first one is kept to be printed again for the next ones, under a header of their own. The first
+   one's bytes are kept with its body, as its file may be unmapped by then, and an object only gets the body if its
+   bytes are the same. Bodies and bytes are kept up to DEDUP_MAX bytes in all, objects that come after that are read
+   as usual. A body that was partly written out before it was complete isn't kept, its copies are read as usual too.
+
+   The first copy claims its entry until its body is kept. Copies read meanwhile on other threads wait for it, unless
+   their thread holds a claim of its own: a file sorting its symbols on several threads can pick up an archive member
+   while it waits on them, and the claims it holds would never be released if that member waited.
+*/
+
+enum                    e_entry {
+    ENTRY_EMPTY,
+    ENTRY_BUSY,
+    ENTRY_KEPT,
+    ENTRY_SKIPPED
+};
+
+typedef struct          s_entry {
+    uint64_t            digest[2];
+    char                *body;
+    size_t              length;
+    char                *data;
+    uint64_t            size;
+    enum e_entry        state;
+}                       t_entry;
+
+struct                  s_dedup {
+    pthread_mutex_t     lock;
+    pthread_cond_t      changed;
+    t_entry             *entries;
+    size_t              nentries;
+    size_t              capacity;
+    size_t              kept;
+    size_t              objects;
+    size_t              skipped;
+    uint64_t            bytes;
+    uint64_t            skipped_bytes;
+};
+
+/* How many entries the current thread has claimed and not released yet. */
+static _Thread_local unsigned   claims;
+
+t_dedup *
+dedup_new (void) {
+
+    t_dedup *dedup = calloc(1, sizeof(t_dedup));
+
+    if (dedup == NULL) return NULL;
+    *dedup = (t_dedup){.lock = PTHREAD_MUTEX_INITIALIZER, .changed = PTHREAD_COND_INITIALIZER};
+    return dedup;
+}
+
+void
+dedup_del (t_dedup *dedup) {
+
+    if (dedup == NULL) return;
+
+    for (size_t k = 0; k < dedup->capacity; k++) {
+
+        free(dedup->entries[k].body);
+        free(dedup->entries[k].data);
+    }
+
+    pthread_mutex_destroy(&dedup->lock);
+    pthread_cond_destroy(&dedup->changed);
+    free(dedup->entries);
+    free(dedup);
+}
+
+static uint64_t
+mix (uint64_t lane, uint64_t word, uint64_t k1, uint64_t k2) {
+
+    lane ^= word * k1;
+    lane = lane << 31 | lane >> 33;
+    return lane * k2;
+}
+
+static uint64_t
+fmix (uint64_t lane) {
+
+    lane ^= lane >> 33;
+    lane *= DEDUP_K2;
+    lane ^= lane >> 29;
+    lane *= DEDUP_K1;
+    return lane ^ lane >> 32;
+}
+
+void
+dedup_digest (const void *data, size_t size, uint64_t salt, uint64_t digest[2]) {
+
+    const unsigned char *bytes = data;
+    uint64_t            words[2];
+    uint64_t            a = DEDUP_K1 ^ size, b = DEDUP_K2 ^ salt;
+    size_t              k = 0;
+
+    /* Two independent lanes over 16 bytes at a time, the tail padded with zeros and told apart by the size. */
+    for ( ; k + sizeof words <= size; k += sizeof words) {
+
+        __builtin_memcpy(words, bytes + k, sizeof words);
+        a = mix(a, words[0], DEDUP_K1, DEDUP_K2);
+        b = mix(b, words[1], DEDUP_K2, DEDUP_K1);
+    }
+
+    if (k < size) {
+
+        words[0] = words[1] = 0;
+        __builtin_memcpy(words, bytes + k, size - k);
+        a = mix(a, words[0], DEDUP_K1, DEDUP_K2);
+        b = mix(b, words[1], DEDUP_K2, DEDUP_K1);
+    }
+
+    a = fmix(a ^ b);
+    b = fmix(b ^ a);
+    digest[0] = a;
+    digest[1] = b;
+}
+
+static t_entry *
+slot (const t_dedup *dedup, const uint64_t digest[2]) {
+
+    /* Open addressing, the capacity is a power of two. */
+    size_t k = (size_t)digest[0] & (dedup->capacity - 1);
+
+    while (dedup->entries[k].state != ENTRY_EMPTY
+           && (dedup->entries[k].digest[0] != digest[0] || dedup->entries[k].digest[1] != digest[1]))
+        k = (k + 1) & (dedup->capacity - 1);
+
+    return &dedup->entries[k];
+}
+
+static bool
+grow (t_dedup *dedup) {
+
+    const size_t    capacity = dedup->capacity ? dedup->capacity * 2 : 64;
+    t_entry         *entries = dedup->entries;
+    const size_t    previous = dedup->capacity;
+
+    dedup->entries = calloc(capacity, sizeof *entries);
+    if (dedup->entries == NULL) return (dedup->entries = entries), false;
+
+    dedup->capacity = capacity;
+    for (size_t k = 0; k < previous; k++)
+        if (entries[k].state != ENTRY_EMPTY) *slot(dedup, entries[k].digest) = entries[k];
+
+    free(entries);
+    return true;
+}
+
+int
+dedup_find (t_dedup *dedup, const uint64_t digest[2], const void *data, uint64_t size, const char **body,
+        size_t *length) {
+
+    t_entry *entry;
+    int     found = DEDUP_MISS;
+
+    /*
+       A claim has to be released with dedup_keep(), whether the object could be read or not. Bodies and bytes are
+       never freed nor moved before the table is deleted, so they can be read once the lock is released.
+    */
+
+    pthread_mutex_lock(&dedup->lock);
+    dedup->objects++;
+    dedup->bytes += size;
+    if ((dedup->nentries + 1) * 2 > dedup->capacity && grow(dedup) == false) {
+
+        pthread_mutex_unlock(&dedup->lock);
+        return DEDUP_MISS;
+    }
+
+    while ((entry = slot(dedup, digest))->state == ENTRY_BUSY && claims == 0)
+        pthread_cond_wait(&dedup->changed, &dedup->lock);
+
+    const char      *kept = entry->data;
+    const uint64_t  kept_size = entry->size;
+
+    if (entry->state == ENTRY_KEPT) {
+
+        *body = entry->body;
+        *length = entry->length;
+        found = DEDUP_FOUND;
+    } else if (entry->state == ENTRY_EMPTY) {
+
+        *entry = (t_entry){.digest = {digest[0], digest[1]}, .state = ENTRY_BUSY};
+        dedup->nentries++;
+        claims++;
+        found = DEDUP_CLAIMED;
+    }
+
+    pthread_mutex_unlock(&dedup->lock);
+
+    /* The hash only finds the object to compare with, the bytes are compared outside the lock. A collision is read. */
+    if (found != DEDUP_FOUND) return found;
+    if (kept_size != size || ft_memcmp(kept, data, size) != 0) return DEDUP_MISS;
+
+    pthread_mutex_lock(&dedup->lock);
+    dedup->skipped++;
+    dedup->skipped_bytes += size;
+    pthread_mutex_unlock(&dedup->lock);
+    return DEDUP_FOUND;
+}
+
+void
+dedup_keep (t_dedup *dedup, const uint64_t digest[2], const void *data, uint64_t size, const char *body,
+        size_t length) {
+
+    /* Without a body, or past the bound, the object's copies are read as usual. */
+    pthread_mutex_lock(&dedup->lock);
+
+    t_entry     *entry = slot(dedup, digest);
+    const bool  fits = body != NULL && dedup->kept + length + size <= DEDUP_MAX;
+    char        *copy = fits ? malloc(length + 1) : NULL;
+    char        *bytes = fits ? malloc(size ? size : 1) : NULL;
+
+    entry->state = ENTRY_SKIPPED;
+    if (copy != NULL && bytes != NULL) {
+
+        ft_memcpy(copy, body, length);
+        copy[length] = '\0';
+        ft_memcpy(bytes, data, size);
+        *entry = (t_entry){.digest = {digest[0], digest[1]}, .body = copy, .length = length, .data = bytes,
+                .size = size, .state = ENTRY_KEPT};
+        dedup->kept += length + size;
+    } else {
+
+        free(copy);
+        free(bytes);
+    }
+
+    claims--;
+    pthread_cond_broadcast(&dedup->changed);
+    pthread_mutex_unlock(&dedup->lock);
+}
+
+void
+dedup_report (const t_dedup *dedup, const t_ofile *ofile, const t_meta *meta) {
+
+    const unsigned long long    skipped = dedup->skipped_bytes;
+    const unsigned long long    bytes = dedup->bytes;
+
+    /* Counts go with the errors, to the caller's buffers when the batch is captured. */
+    if (ofile->output != NULL)
+        ft_dstrfpush(ofile->errors, DEDUP_REPORT, meta->bin, dedup->skipped, dedup->objects, skipped, bytes);
+    else ft_fprintf(stderr, DEDUP_REPORT, meta->bin, dedup->skipped, dedup->objects, skipped, bytes);
+}
@@ -0,0 +1,303 @@
+#include "ofilep.h"
+#if defined(__x86_64__) || defined(__i386__)
+# include <tmmintrin.h>
+# define HEXDUMP_SSSE3
+#endif
+
+#define HEXDUMP_BLOCK 16384
+#define HEXDUMP_LINE 96
+#define HEXDUMP_PARALLEL (1UL << 20)
+#define HEXDUMP_CHUNK (64UL << 10)
+
+typedef char            *(*t_line)(char *, const t_object *, const uint8_t *, bool);
+
+typedef struct          s_dump {
+    t_ofile             *ofile;
+    const t_object      *object;
+    const uint8_t       *data;
+    uint64_t            addr;
+    uint64_t            size;
+    t_line              line;
+    int                 width;
+    bool                words;
+    uint64_t            first;
+    char                *buffs;
+    size_t              *sizes;
+}                       t_dump;
+
+static const char       hexdigits[16] = {
+        '0', '1', '2', '3', '4', '5', '6', '7', '8', '9', 'a', 'b', 'c', 'd', 'e', 'f'
+};
+
+static char *
+hexbyte (char *out, uint8_t byte) {
+
+    out[0] = hexdigits[byte >> 4];
+    out[1] = hexdigits[byte & 0xf];
+    return out + 2;
+}
+
+static char *
+hexaddr (char *out, uint64_t addr, int width) {
+
+    /* Like "%0*llx", the address is padded to the width but never truncated to it. */
+    while (width < 16 && addr >> (4 * width) != 0) width++;
+    for (int k = width - 1; k >= 0; k--, addr >>= 4) out[k] = hexdigits[addr & 0xf];
+
+    out[width] = '\t';
+    return out + width + 1;
+}
+
+static char *
+hexword (char *out, const t_object *object, const uint8_t *data) {
+
+    uint32_t word;
+
+    ft_memcpy(&word, data, sizeof word);
+    word = oswap_32(object, word);
+    for (int k = 3; k >= 0; k--) out = hexbyte(out, (uint8_t)(word >> (8 * k)));
+
+    *out = ' ';
+    return out + 1;
+}
+
+static char *
+line_scalar (char *out, const t_object *object, const uint8_t *data, bool words) {
+
+    uint64_t    halves[2];
+    const bool  big_endian = __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__;
+
+    /*
+       Words are printed most significant byte first, which is the order they are stored in big-endian objects. The
+       words of little-endian ones are swapped all at once, by reversing each half of the line and swapping its words
+       back in place, and then printed like bytes.
+    */
+
+    if (words == true && object->is_cigam == big_endian) {
+
+        ft_memcpy(halves, data, sizeof halves);
+        for (int k = 0; k < 2; k++) halves[k] = __builtin_bswap64(halves[k]) >> 32 | __builtin_bswap64(halves[k]) << 32;
+        data = (const uint8_t *)halves;
+    }
+
+    for (size_t k = 0; k < 16; k++) {
+
+        out = hexbyte(out, data[k]);
+        if (words == false || k % 4 == 3) *out++ = ' ';
+    }
+
+    return out;
+}
+
+#ifdef HEXDUMP_SSSE3
+
+/*
+   For each 16 characters of a line, where to take them from in the digits of the first and last 8 bytes of the line.
+   -1 leaves a zero, which becomes a space.
+*/
+
+static const int8_t     layouts[2][2][3][16] = {
+        {
+                {
+                        { 0,  1, -1,  2,  3, -1,  4,  5, -1,  6,  7, -1,  8,  9, -1, 10},
+                        {11, -1, 12, 13, -1, 14, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+                        {-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1}
+                }, {
+                        {-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+                        {-1, -1, -1, -1, -1, -1, -1, -1,  0,  1, -1,  2,  3, -1,  4,  5},
+                        {-1,  6,  7, -1,  8,  9, -1, 10, 11, -1, 12, 13, -1, 14, 15, -1}
+                }
+        }, {
+                {
+                        { 0,  1,  2,  3,  4,  5,  6,  7, -1,  8,  9, 10, 11, 12, 13, 14},
+                        {15, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+                        {-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1}
+                }, {
+                        {-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+                        {-1, -1,  0,  1,  2,  3,  4,  5,  6,  7, -1,  8,  9, 10, 11, 12},
+                        {13, 14, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1}
+                }
+        }
+};
+
+static const int8_t     byteswap[16] = {3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12};
+
+__attribute__((target("ssse3")))
+static char *
+line_ssse3 (char *out, const t_object *object, const uint8_t *data, bool words) {
+
+    const __m128i   digits = _mm_loadu_si128((const __m128i *)hexdigits);
+    const __m128i   nibble = _mm_set1_epi8(0x0f);
+    __m128i         bytes = _mm_loadu_si128((const __m128i *)data);
+
+    /* Words are printed most significant byte first, this host being little endian. */
+    if (words == true && object->is_cigam == false)
+        bytes = _mm_shuffle_epi8(bytes, _mm_loadu_si128((const __m128i *)byteswap));
+
+    const __m128i   high = _mm_shuffle_epi8(digits, _mm_and_si128(_mm_srli_epi16(bytes, 4), nibble));
+    const __m128i   low = _mm_shuffle_epi8(digits, _mm_and_si128(bytes, nibble));
+    const __m128i   first = _mm_unpacklo_epi8(high, low);
+    const __m128i   last = _mm_unpackhi_epi8(high, low);
+
+    /* Lines are stored 16 characters at a time, what goes past the end of the line is overwritten afterwards. */
+    for (int k = 0; k < 3; k++) {
+
+        __m128i chunk = _mm_or_si128(
+                _mm_shuffle_epi8(first, _mm_loadu_si128((const __m128i *)layouts[words][0][k])),
+                _mm_shuffle_epi8(last, _mm_loadu_si128((const __m128i *)layouts[words][1][k])));
+
+        chunk = _mm_or_si128(chunk, _mm_and_si128(_mm_cmpeq_epi8(chunk, _mm_setzero_si128()), _mm_set1_epi8(' ')));
+        _mm_storeu_si128((__m128i *)(out + 16 * k), chunk);
+    }
+
+    return out + (words ? 36 : 48);
+}
+
+#endif
+
+static t_line
+hexdump_line (void) {
+
+#ifdef HEXDUMP_SSSE3
+    if (getenv("FT_OTOOL_SCALAR") == NULL && __builtin_cpu_supports("ssse3")) return line_ssse3;
+#endif
+    return line_scalar;
+}
+
+static char *
+dump_line (char *out, const t_dump *dump, uint64_t k) {
+
+    const uint64_t size = dump->size;
+
+    /* Whole lines go through the line kernel. The last one is formatted one byte or word at a time. */
+    out = hexaddr(out, dump->addr + k, dump->width);
+    if (size - k >= 16) out = dump->line(out, dump->object, dump->data + k, dump->words);
+    else if (dump->words == true) {
+
+        /* As with a dump word by word, the last word is read whole. */
+        for (uint64_t word = k; word < size; word += 4) out = hexword(out, dump->object, dump->data + word);
+    } else {
+
+        for (uint64_t byte = k; byte < size; byte++) {
+
+            out = hexbyte(out, dump->data[byte]);
+            *out++ = ' ';
+        }
+    }
+
+    /* A last partial word doesn't end its line, unless it's the last word of the line. */
+    if (dump->words == false || size - k > 12 || size % 4 == 0) *out++ = '\n';
+    return out;
+}
+
+static void
+dump_chunk (void *ctx, size_t k) {
+
+    const t_dump    *dump = ctx;
+    const uint64_t  start = (dump->first + k) * HEXDUMP_CHUNK;
+    const uint64_t  end = (dump->size - start < HEXDUMP_CHUNK) ? dump->size : start + HEXDUMP_CHUNK;
+    char            *buff = dump->buffs + k * (HEXDUMP_CHUNK / 16 * HEXDUMP_LINE);
+    char            *out = buff;
+
+    for (uint64_t line = start; line < end; line += 16) out = dump_line(out, dump, line);
+    dump->sizes[k] = (size_t)(out - buff);
+}
+
+static int
+emit_chunk (void *ctx, size_t k) {
+
+    const t_dump *dump = ctx;
+
+    push_output(dump->ofile, dump->buffs + k * (HEXDUMP_CHUNK / 16 * HEXDUMP_LINE), dump->sizes[k]);
+    return EXIT_SUCCESS;
+}
+
+static void
+dump_windows (void *ctx, size_t k) {
+
+    t_dump          *dump = ctx;
+    const uint64_t  nchunks = (dump->size + HEXDUMP_CHUNK - 1) / HEXDUMP_CHUNK;
+    const size_t    window = (size_t)dump->ofile->jobs * 4;
+
+    (void)k;
+    for (dump->first = 0; dump->first < nchunks; dump->first += window) {
+
+        const size_t count = (nchunks - dump->first < window) ? (size_t)(nchunks - dump->first) : window;
+
+        pool_run(count, dump->ofile->jobs, dump_chunk, emit_chunk, dump);
+    }
+}
+
+static int
+emit_windows (void *ctx, size_t k) {
+
+    (void)ctx;
+    (void)k;
+    return EXIT_SUCCESS;
+}
+
+static bool
+parallel_dump (t_dump *dump) {
+
+    const size_t window = (size_t)dump->ofile->jobs * 4;
+
+    /*
+       Chunks start on line boundaries, so each one is formatted on its own, addresses included, into a buffer large
+       enough for any of its lines. Chunks are dumped a few per thread at a time, which keeps the buffers in use
+       bounded however large the section is, while each window is still written in order as its chunks complete.
+
+       The windows all go through one pool: the loop over them is a task itself, from which each window's chunks are
+       handed to the workers that are already running, rather than to threads started and joined for each window.
+    */
+
+    dump->buffs = malloc(window * (HEXDUMP_CHUNK / 16 * HEXDUMP_LINE));
+    dump->sizes = malloc(window * sizeof *dump->sizes);
+    if (dump->buffs == NULL || dump->sizes == NULL) {
+
+        free(dump->buffs);
+        free(dump->sizes);
+        return false;
+    }
+
+    pool_run(1, dump->ofile->jobs, dump_windows, emit_windows, dump);
+
+    free(dump->buffs);
+    free(dump->sizes);
+    return true;
+}
+
+void
+hexdump (t_ofile *ofile, const t_object *object, uint64_t offset, uint64_t addr, uint64_t size) {
+
+    char    block[HEXDUMP_BLOCK + HEXDUMP_LINE];
+    char    *out = block;
+    t_dump  dump = {
+            .ofile = ofile,
+            .object = object,
+            .data = (const uint8_t *)object->object + offset,
+            .addr = addr,
+            .size = size,
+            .line = hexdump_line(),
+            .width = object->is_64 ? 16 : 8,
+
+            /* Other architectures than x86 are dumped in 32-bit words, in the object's byte order. */
+            .words = (object->nxArchInfo == NULL || (object->nxArchInfo->cputype != CPU_TYPE_I386
+                    && object->nxArchInfo->cputype != CPU_TYPE_X86_64))
+    };
+
+    /* Large sections are split between threads when there are some to spare, if the buffers can be had. */
+    if (ofile->jobs > 1 && size >= HEXDUMP_PARALLEL && parallel_dump(&dump)) return;
+
+    /* Otherwise lines are formatted into a block, which is pushed to the output once full. */
+    for (uint64_t k = 0; k < size; k += 16) {
+
+        out = dump_line(out, &dump, k);
+        if (out - block >= HEXDUMP_BLOCK) {
+
+            push_output(ofile, block, (size_t)(out - block));
+            out = block;
+        }
+    }
+
+    if (out != block) push_output(ofile, block, (size_t)(out - block));
+}
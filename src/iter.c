@@ -0,0 +1,486 @@
+#include "ofilep.h"
+#include <ar.h>
+#include <fcntl.h>
+#include <mach-o/fat.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define SAR_EFMT1 3
+#define ARCH_NAME 32
+
+struct                  s_of_file {
+    const char          *path;
+    const char          *data;
+    size_t              size;
+    bool                mapped;
+    bool                done;
+    const char          *fat;
+    uint32_t            nfat_arch;
+    uint32_t            k_arch;
+    bool                fat_64;
+    bool                fat_cigam;
+    const char          *archive;
+    size_t              archive_size;
+    size_t              member;
+    char                arch[ARCH_NAME];
+};
+
+static int
+fail (t_of_error *error, int errcode) {
+
+    error->errcode = errcode;
+    error->sys_errno = (errcode == E_RRNO) ? errno : 0;
+    return OF_ERROR;
+}
+
+static bool
+in_bounds (size_t size, uint64_t offset, uint64_t length) {
+
+    return offset <= size && length <= size - offset;
+}
+
+static int
+describe (t_of_file *file, t_of_object *object, const char *data, size_t size, t_of_error *error) {
+
+    uint32_t magic;
+
+    /*
+       Objects are checked for a Mach-O magic and a whole header. The architecture is looked up from the header, and
+       its name copied, as some systems allocate the ones they make up.
+    */
+
+    if (size < sizeof magic) return fail(error, E_GARBAGE);
+    ft_memcpy(&magic, data, sizeof magic);
+    if (magic != MH_MAGIC && magic != MH_CIGAM && magic != MH_MAGIC_64 && magic != MH_CIGAM_64)
+        return fail(error, (object->member != NULL || file->fat != NULL) ? E_MAGIC : E_GARBAGE);
+
+    const bool is_64 = magic == MH_MAGIC_64 || magic == MH_CIGAM_64;
+    const bool is_cigam = magic == MH_CIGAM || magic == MH_CIGAM_64;
+    if (size < (is_64 ? sizeof(struct mach_header_64) : sizeof(struct mach_header))) return fail(error, E_GARBAGE);
+
+    struct mach_header header;
+    ft_memcpy(&header, data, sizeof header);
+
+    object->data = data;
+    object->size = size;
+    object->is_64 = is_64;
+    object->is_cigam = is_cigam;
+    object->cputype = (int32_t)cswap_32(is_cigam, (uint32_t)header.cputype);
+    object->cpusubtype = (int32_t)cswap_32(is_cigam, (uint32_t)header.cpusubtype);
+    object->filetype = cswap_32(is_cigam, header.filetype);
+    object->ncmds = cswap_32(is_cigam, header.ncmds);
+    object->flags = cswap_32(is_cigam, header.flags);
+
+    const NXArchInfo *info = NXGetArchInfoFromCpuType(object->cputype, object->cpusubtype);
+
+    file->arch[0] = '\0';
+    if (info != NULL) {
+
+        const size_t length = ft_strlen(info->name) < ARCH_NAME ? ft_strlen(info->name) : ARCH_NAME - 1;
+
+        ft_memcpy(file->arch, info->name, length);
+        file->arch[length] = '\0';
+        NXFreeArchInfo(info);
+    }
+
+    object->arch = file->arch[0] != '\0' ? file->arch : NULL;
+    return OF_NEXT;
+}
+
+static int
+next_member (t_of_file *file, t_of_object *object, t_of_error *error) {
+
+    /* Each member is a header, then its name for long names, then the member itself. Symbol tables are skipped. */
+    while (file->member < file->archive_size) {
+
+        struct ar_hdr header;
+        if (in_bounds(file->archive_size, file->member, sizeof header) == false) return fail(error, E_AROFFSET);
+        ft_memcpy(&header, file->archive + file->member, sizeof header);
+
+        const size_t    start = file->member + sizeof header;
+        const int       size = ft_atoi(header.ar_size);
+        size_t          name_size = 0;
+
+        error->member = file->archive + file->member;
+        error->member_length = sizeof header.ar_name;
+        object->member = file->archive + file->member;
+        object->member_length = sizeof header.ar_name;
+        if (ft_strnequ(header.ar_name, AR_EFMT1, SAR_EFMT1)) {
+
+            name_size = (size_t)ft_atoi(header.ar_name + SAR_EFMT1);
+            object->member = file->archive + start;
+            object->member_length = name_size;
+        }
+
+        /* A broken header ends the archive, as there is no telling where the next one would be. */
+        if (ft_strnequ(ARFMAG, header.ar_fmag, 2) == 0)
+            return (file->member = file->archive_size), fail(error, E_ARFMAG);
+        if (size < 0 || name_size > (size_t)size || in_bounds(file->archive_size, start, (size_t)size) == false)
+            return (file->member = file->archive_size), fail(error, E_AROFFSET);
+
+        /* Names are padded with spaces, or with NULs for long ones. */
+        while (object->member_length > 0 && (object->member[object->member_length - 1] == ' '
+            || object->member[object->member_length - 1] == '\0')) object->member_length--;
+        for (size_t k = 0; k < object->member_length; k++)
+            if (object->member[k] == '\0') object->member_length = k;
+
+        error->member = object->member;
+        error->member_length = object->member_length;
+        file->member = start + (size_t)size;
+        if (object->member_length >= 9 && ft_strnequ(object->member, "__.SYMDEF", 9)) continue;
+        return describe(file, object, file->archive + start + name_size, (size_t)size - name_size, error);
+    }
+
+    return OF_END;
+}
+
+static int
+start_container (t_of_file *file, t_of_object *object, const char *data, size_t size, t_of_error *error) {
+
+    if (size >= SARMAG && ft_strnequ(data, ARMAG, SARMAG)) {
+
+        file->archive = data;
+        file->archive_size = size;
+        file->member = SARMAG;
+        return OF_END;
+    }
+
+    return describe(file, object, data, size, error);
+}
+
+static int
+next_slice (t_of_file *file, t_of_object *object, t_of_error *error) {
+
+    const size_t stride = file->fat_64 ? sizeof(struct fat_arch_64) : sizeof(struct fat_arch);
+    const size_t offset = sizeof(struct fat_header) + file->k_arch * stride;
+
+    if (file->k_arch >= file->nfat_arch) return (file->done = true), OF_END;
+    if (in_bounds(file->size, offset, stride) == false) return (file->done = true), fail(error, E_GARBAGE);
+    file->k_arch++;
+
+    uint64_t            start, size;
+    struct fat_arch_64  arch;
+
+    /* Slices are either objects or archives, which are then walked member by member. */
+    ft_memcpy(&arch, file->fat + offset, stride);
+    error->cputype = (int32_t)cswap_32(file->fat_cigam, (uint32_t)arch.cputype);
+    error->cpusubtype = (int32_t)cswap_32(file->fat_cigam, (uint32_t)arch.cpusubtype);
+
+    /* nm and otool take a slice of an architecture they don't know for one overlapping the fat headers. */
+    const NXArchInfo *info = NXGetArchInfoFromCpuType(error->cputype, error->cpusubtype);
+
+    if (info == NULL) return (file->done = true), fail(error, E_AROVERLAP);
+    NXFreeArchInfo(info);
+    if (file->fat_64) {
+
+        start = cswap_64(file->fat_cigam, arch.offset);
+        size = cswap_64(file->fat_cigam, arch.size);
+    } else {
+
+        const struct fat_arch *arch_32 = (const struct fat_arch *)&arch;
+        start = cswap_32(file->fat_cigam, arch_32->offset);
+        size = cswap_32(file->fat_cigam, arch_32->size);
+    }
+
+    /* As with nm and otool, a slice past the end of the file stops the walk. */
+    if (in_bounds(file->size, start, size) == false) return (file->done = true), fail(error, E_FATOFF);
+    return start_container(file, object, file->data + start, (size_t)size, error);
+}
+
+int
+of_next_object (t_of_file *file, t_of_object *object, t_of_error *error) {
+
+    *error = (t_of_error){.path = file->path};
+
+    while (file->done == false) {
+
+        int next;
+
+        *object = (t_of_object){0};
+        if (file->archive != NULL) {
+
+            if ((next = next_member(file, object, error)) != OF_END) return next;
+            file->archive = NULL;
+            if (file->fat == NULL) file->done = true;
+            continue;
+        }
+
+        if (file->fat != NULL) {
+
+            if ((next = next_slice(file, object, error)) != OF_END) return next;
+            continue;
+        }
+
+        /* The first call looks at the file itself, which is an object, a fat file or an archive. */
+        uint32_t magic = 0;
+
+        ft_memcpy(&magic, file->data, sizeof magic);
+        if (magic == FAT_MAGIC || magic == FAT_CIGAM || magic == FAT_MAGIC_64 || magic == FAT_CIGAM_64) {
+
+            file->fat = file->data;
+            file->fat_64 = magic == FAT_MAGIC_64 || magic == FAT_CIGAM_64;
+            file->fat_cigam = magic == FAT_CIGAM || magic == FAT_CIGAM_64;
+            if (file->size < sizeof(struct fat_header)) return (file->done = true), fail(error, E_GARBAGE);
+            file->nfat_arch = cswap_32(file->fat_cigam, ((const struct fat_header *)file->data)->nfat_arch);
+            continue;
+        }
+
+        if ((next = start_container(file, object, file->data, file->size, error)) != OF_END) {
+
+            file->done = true;
+            return next;
+        }
+    }
+
+    return OF_END;
+}
+
+int
+of_next_command (const t_of_object *object, t_of_cursor *cursor, t_of_command *command, t_of_error *error) {
+
+    const size_t header = object->is_64 ? sizeof(struct mach_header_64) : sizeof(struct mach_header);
+    struct load_command loader;
+
+    /* The same checks as nm and otool, on each command as it's reached. */
+    if (cursor->offset == 0) cursor->offset = header;
+    if (cursor->k_command >= object->ncmds) return OF_END;
+
+    error->command = cursor->k_command;
+    if (in_bounds(object->size, cursor->offset, sizeof loader) == false) return fail(error, E_GARBAGE);
+    ft_memcpy(&loader, (const char *)object->data + cursor->offset, sizeof loader);
+
+    const uint32_t cmdsize = cswap_32(object->is_cigam, loader.cmdsize);
+
+    if (in_bounds(object->size, cursor->offset, cmdsize) == false) return fail(error, E_LOADOFF);
+    if (cmdsize % (object->is_64 ? 8 : 4)) return fail(error, E_INV4L);
+    if (cmdsize == 0) return fail(error, E_LOADOFF);
+
+    *command = (t_of_command){
+            .data = (const char *)object->data + cursor->offset,
+            .offset = cursor->offset,
+            .cmd = cswap_32(object->is_cigam, loader.cmd),
+            .cmdsize = cmdsize,
+            .index = cursor->k_command
+    };
+
+    cursor->offset += cmdsize;
+    cursor->k_command++;
+    return OF_NEXT;
+}
+
+static int
+section (const t_of_object *object, t_of_cursor *cursor, t_of_section *section) {
+
+    const char *data = (const char *)object->data + cursor->section;
+
+    /* Both layouts start with the names, the 64-bit one has wider addresses and sizes. */
+    ft_memcpy(section->sectname, data, 16);
+    ft_memcpy(section->segname, data + 16, 16);
+    section->sectname[16] = section->segname[16] = '\0';
+    if (object->is_64) {
+
+        struct section_64 raw;
+        ft_memcpy(&raw, data, sizeof raw);
+        section->addr = cswap_64(object->is_cigam, raw.addr);
+        section->size = cswap_64(object->is_cigam, raw.size);
+        section->offset = cswap_32(object->is_cigam, raw.offset);
+        section->flags = cswap_32(object->is_cigam, raw.flags);
+        cursor->section += sizeof raw;
+    } else {
+
+        struct section raw;
+        ft_memcpy(&raw, data, sizeof raw);
+        section->addr = cswap_32(object->is_cigam, raw.addr);
+        section->size = cswap_32(object->is_cigam, raw.size);
+        section->offset = cswap_32(object->is_cigam, raw.offset);
+        section->flags = cswap_32(object->is_cigam, raw.flags);
+        cursor->section += sizeof raw;
+    }
+
+    section->index = ++cursor->index;
+    cursor->k_sect++;
+    return OF_NEXT;
+}
+
+static int
+segment (const t_of_object *object, const t_of_command *command, uint32_t *nsects, t_of_error *error) {
+
+    const size_t    segment_size = object->is_64 ? sizeof(struct segment_command_64) : sizeof(struct segment_command);
+    const size_t    section_size = object->is_64 ? sizeof(struct section_64) : sizeof(struct section);
+    uint64_t        fileoff, filesize;
+
+    if (command->cmdsize < segment_size) return fail(error, E_GARBAGE);
+    if (object->is_64) {
+
+        struct segment_command_64 raw;
+        ft_memcpy(&raw, command->data, sizeof raw);
+        fileoff = cswap_64(object->is_cigam, raw.fileoff);
+        filesize = cswap_64(object->is_cigam, raw.filesize);
+        *nsects = cswap_32(object->is_cigam, raw.nsects);
+    } else {
+
+        struct segment_command raw;
+        ft_memcpy(&raw, command->data, sizeof raw);
+        fileoff = cswap_32(object->is_cigam, raw.fileoff);
+        filesize = cswap_32(object->is_cigam, raw.filesize);
+        *nsects = cswap_32(object->is_cigam, raw.nsects);
+    }
+
+    if (in_bounds(object->size, fileoff, filesize) == false) return fail(error, E_SEGOFF);
+    if (in_bounds(object->size, command->offset + segment_size, (uint64_t)*nsects * section_size) == false)
+        return fail(error, E_GARBAGE);
+    return OF_NEXT;
+}
+
+int
+of_next_section (const t_of_object *object, t_of_cursor *cursor, t_of_section *section_out, t_of_error *error) {
+
+    t_of_command    command;
+    uint32_t        nsects;
+    int             next;
+
+    /* Sections follow their segment's command. Segments are checked as they are reached. */
+    while (cursor->k_sect == cursor->nsects) {
+
+        if ((next = of_next_command(object, cursor, &command, error)) != OF_NEXT) return next;
+        if (command.cmd != (object->is_64 ? LC_SEGMENT_64 : LC_SEGMENT)) continue;
+        if (segment(object, &command, &nsects, error) == OF_ERROR) return OF_ERROR;
+
+        cursor->section = command.offset + (object->is_64 ? sizeof(struct segment_command_64)
+                : sizeof(struct segment_command));
+        cursor->nsects = nsects;
+        cursor->k_sect = 0;
+    }
+
+    return section(object, cursor, section_out);
+}
+
+static int
+find_symtab (const t_of_object *object, t_of_cursor *cursor, t_of_error *error) {
+
+    t_of_cursor     commands = {0};
+    t_of_command    command;
+    uint32_t        nsects;
+    int             next;
+
+    /* The symbol table is looked for once, after every command and segment has been checked, as nm does. */
+    while ((next = of_next_command(object, &commands, &command, error)) == OF_NEXT) {
+
+        if (command.cmd == (object->is_64 ? LC_SEGMENT_64 : LC_SEGMENT)
+            && segment(object, &command, &nsects, error) == OF_ERROR) return OF_ERROR;
+        if (command.cmd == LC_SYMTAB && command.cmdsize >= sizeof(struct symtab_command))
+            cursor->symtab = command.offset;
+    }
+
+    return next;
+}
+
+int
+of_next_symbol (const t_of_object *object, t_of_cursor *cursor, t_of_symbol *symbol, t_of_error *error) {
+
+    struct symtab_command   symtab;
+    struct nlist_64         nlist;
+    const size_t            nlist_size = object->is_64 ? sizeof(struct nlist_64) : sizeof(struct nlist);
+
+    if (cursor->symtab == 0 && cursor->k_sym == 0) {
+
+        if (find_symtab(object, cursor, error) == OF_ERROR) return OF_ERROR;
+
+        /* A table was looked for, whether or not there is one. */
+        cursor->k_sym = 1;
+    }
+
+    if (cursor->symtab == 0) return OF_END;
+    ft_memcpy(&symtab, (const char *)object->data + cursor->symtab, sizeof symtab);
+
+    const uint32_t  nsyms = cswap_32(object->is_cigam, symtab.nsyms);
+    const uint32_t  stroff = cswap_32(object->is_cigam, symtab.stroff);
+    const uint32_t  strsize = cswap_32(object->is_cigam, symtab.strsize);
+    const uint32_t  k = cursor->k_sym - 1;
+    const uint64_t  offset = cswap_32(object->is_cigam, symtab.symoff) + (uint64_t)k * nlist_size;
+
+    if (k >= nsyms) return OF_END;
+    error->symbol = k;
+    if (in_bounds(object->size, offset, nlist_size) == false) return (errno = 0), fail(error, E_RRNO);
+    ft_memcpy(&nlist, (const char *)object->data + offset, nlist_size);
+
+    /* Names must end inside the string table, or inside the object for indexes past the table. */
+    const uint32_t  n_strx = cswap_32(object->is_cigam, nlist.n_un.n_strx);
+    const size_t    strend = in_bounds(object->size, stroff, strsize) ? (size_t)stroff + strsize : object->size;
+    const size_t    end = (n_strx < strsize) ? strend : object->size;
+    const char      *name = (const char *)object->data + stroff + n_strx;
+
+    if ((uint64_t)stroff + n_strx > object->size) return fail(error, E_SYMSTRX);
+
+    const char *nul = ((size_t)stroff + n_strx < end) ? memchr(name, '\0', end - stroff - n_strx) : NULL;
+    if (nul == NULL) return fail(error, E_SYMNAME);
+
+    *symbol = (t_of_symbol){
+            .name = name,
+            .length = (size_t)(nul - name),
+            .type = nlist.n_type,
+            .sect = nlist.n_sect,
+            .desc = cswap_16(object->is_cigam, (uint16_t)nlist.n_desc),
+            .value = object->is_64
+                    ? cswap_64(object->is_cigam, nlist.n_value)
+                    : cswap_32(object->is_cigam, ((const struct nlist *)&nlist)->n_value)
+    };
+
+    cursor->k_sym++;
+    return OF_NEXT;
+}
+
+int
+of_open_memory (const void *data, size_t size, const char *name, t_of_file **file, t_of_error *error) {
+
+    *error = (t_of_error){.path = name};
+    if (size < sizeof(uint32_t)) return fail(error, E_GARBAGE), EXIT_FAILURE;
+    if ((*file = calloc(1, sizeof(t_of_file))) == NULL) return fail(error, E_RRNO), EXIT_FAILURE;
+
+    (*file)->path = name;
+    (*file)->data = data;
+    (*file)->size = size;
+    return EXIT_SUCCESS;
+}
+
+int
+of_open (const char *path, t_of_file **file, t_of_error *error) {
+
+    struct stat info;
+    const int   fd = open(path, O_RDONLY);
+
+    *error = (t_of_error){.path = path};
+    if (fd == -1) return fail(error, E_RRNO), EXIT_FAILURE;
+    if (fstat(fd, &info) == -1) return fail(error, E_RRNO), close(fd), EXIT_FAILURE;
+    if (S_ISDIR(info.st_mode)) {
+
+        errno = EISDIR;
+        fail(error, E_RRNO);
+        close(fd);
+        return EXIT_FAILURE;
+    }
+
+    if ((size_t)info.st_size < sizeof(uint32_t)) return close(fd), fail(error, E_GARBAGE), EXIT_FAILURE;
+
+    const void *data = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+    close(fd);
+    if (data == MAP_FAILED) return fail(error, E_RRNO), EXIT_FAILURE;
+    if (of_open_memory(data, (size_t)info.st_size, path, file, error) != EXIT_SUCCESS) {
+
+        munmap((void *)data, (size_t)info.st_size);
+        return EXIT_FAILURE;
+    }
+
+    (*file)->mapped = true;
+    return EXIT_SUCCESS;
+}
+
+void
+of_close (t_of_file *file) {
+
+    if (file == NULL) return;
+    if (file->mapped) munmap((void *)file->data, file->size);
+    free(file);
+}
@@ -0,0 +1,204 @@
+#include "ofilep.h"
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define MAPS_MAX 32
+
+#ifdef __APPLE__
+# define st_mtim st_mtimespec
+#endif
+
+typedef struct          s_mapping {
+    const void          *file;
+    size_t              size;
+    dev_t               dev;
+    ino_t               ino;
+    struct timespec     mtime;
+    unsigned long       used;
+    unsigned            refs;
+}                       t_mapping;
+
+struct                  s_maps {
+    pthread_mutex_t     lock;
+    t_mapping           mappings[MAPS_MAX];
+    unsigned long       clock;
+};
+
+t_maps *
+maps_new (void) {
+
+    t_maps *maps = calloc(1, sizeof(t_maps));
+
+    if (maps != NULL && pthread_mutex_init(&maps->lock, NULL) != 0) {
+
+        free(maps);
+        return NULL;
+    }
+
+    return maps;
+}
+
+void
+maps_del (t_maps *maps) {
+
+    if (maps == NULL) return;
+
+    for (size_t k = 0; k < MAPS_MAX; k++)
+        if (maps->mappings[k].file != NULL) munmap((void *)maps->mappings[k].file, maps->mappings[k].size);
+
+    pthread_mutex_destroy(&maps->lock);
+    free(maps);
+}
+
+static const void *
+maps_get (t_maps *maps, const struct stat *stat) {
+
+    const void *file = NULL;
+
+    /*
+       A mapping is only reused if the file still looks the same, otherwise it's left to age out. Files rewritten
+       within the same second are told apart by the nanoseconds of their modification time.
+    */
+
+    pthread_mutex_lock(&maps->lock);
+    for (size_t k = 0; k < MAPS_MAX; k++) {
+
+        t_mapping *mapping = &maps->mappings[k];
+
+        if (mapping->file != NULL && mapping->dev == stat->st_dev && mapping->ino == stat->st_ino
+            && mapping->size == (size_t)stat->st_size && mapping->mtime.tv_sec == stat->st_mtim.tv_sec
+            && mapping->mtime.tv_nsec == stat->st_mtim.tv_nsec) {
+
+            mapping->refs++;
+            mapping->used = ++maps->clock;
+            file = mapping->file;
+            break;
+        }
+    }
+
+    pthread_mutex_unlock(&maps->lock);
+    return file;
+}
+
+static void
+maps_put (t_maps *maps, const struct stat *stat, const void *file) {
+
+    t_mapping *victim = NULL;
+
+    /* Take a free slot, or evict the least recently used mapping that nobody is reading. */
+    pthread_mutex_lock(&maps->lock);
+    for (size_t k = 0; k < MAPS_MAX; k++) {
+
+        t_mapping *mapping = &maps->mappings[k];
+
+        if (mapping->refs == 0 && (victim == NULL || mapping->file == NULL || mapping->used < victim->used)) {
+
+            victim = mapping;
+            if (mapping->file == NULL) break;
+        }
+    }
+
+    if (victim != NULL) {
+
+        if (victim->file != NULL) munmap((void *)victim->file, victim->size);
+        *victim = (t_mapping){
+                .file = file,
+                .size = (size_t)stat->st_size,
+                .dev = stat->st_dev,
+                .ino = stat->st_ino,
+                .mtime = stat->st_mtim,
+                .used = ++maps->clock,
+                .refs = 1
+        };
+    }
+
+    pthread_mutex_unlock(&maps->lock);
+}
+
+static bool
+maps_release (t_maps *maps, const void *file) {
+
+    bool found = false;
+
+    pthread_mutex_lock(&maps->lock);
+    for (size_t k = 0; k < MAPS_MAX && found == false; k++) {
+
+        if (maps->mappings[k].file == file && maps->mappings[k].refs > 0) {
+
+            maps->mappings[k].refs--;
+            found = true;
+        }
+    }
+
+    pthread_mutex_unlock(&maps->lock);
+    return found;
+}
+
+static int
+map_descriptor (t_ofile *ofile, t_meta *meta, const int fd) {
+
+    /* Perform various checks on the file and map it into memory, or reuse a mapping we kept around. */
+    struct stat info;
+
+    if (fstat(fd, &info) == -1) return EXIT_FAILURE; /* E_RRNO */
+
+    /* Pipes can't be mapped, they are read through once instead. */
+    if (S_ISFIFO(info.st_mode) || S_ISCHR(info.st_mode) || S_ISSOCK(info.st_mode))
+        return stream_file(ofile, meta, fd);
+
+    ofile->size = (size_t)info.st_size;
+    if (ofile->size < sizeof(uint32_t)) return (meta->errcode = E_GARBAGE), EXIT_FAILURE;
+    if (info.st_mode & S_IFDIR) {
+
+        meta->errcode = E_RRNO;
+        errno = EISDIR;
+        return EXIT_FAILURE;
+    }
+
+    /* A probe reads the few pages it needs rather than mapping the file, and doesn't keep them past this file. */
+    if (ofile->opt & OTOOL_PROBE) return probe_file(ofile, meta, fd);
+    if (ofile->maps != NULL && (ofile->file = maps_get(ofile->maps, &info)) != NULL) return EXIT_SUCCESS;
+
+    ofile->file = mmap(NULL, ofile->size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (ofile->file == MAP_FAILED) return EXIT_FAILURE;
+
+    /* If every cached mapping is in use, this one is simply unmapped when we're done with it. */
+    if (ofile->maps != NULL) maps_put(ofile->maps, &info, ofile->file);
+    return EXIT_SUCCESS;
+}
+
+int
+map_file (t_ofile *ofile, t_meta *meta) {
+
+    /* A file that was prefetched is already mapped, and was checked to be a regular file large enough for a magic. */
+    if (ofile->file != NULL) return EXIT_SUCCESS;
+    /* Standard input is read through once, like pipes. */
+    if (ft_strequ(meta->path, "-")) return stream_file(ofile, meta, STDIN_FILENO);
+
+    /*
+       The checks, the mapping and the key it's kept under all come from the descriptor, so they are about the same
+       file even if another one is renamed over the path meanwhile.
+    */
+
+    const int fd = open(meta->path, O_RDONLY);
+    if (fd == -1) return EXIT_FAILURE; /* E_RRNO */
+
+    const int retcode = map_descriptor(ofile, meta, fd);
+    const int saved = errno;
+
+    close(fd);
+    errno = saved;
+    return retcode;
+}
+
+void
+unmap_file (const t_ofile *ofile) {
+
+    /* A stream's views are all unmapped along with it. */
+    if (ofile->stream != NULL) stream_del(ofile->stream);
+    else if (ofile->maps == NULL || maps_release(ofile->maps, ofile->file) == false)
+        munmap((void *)ofile->file, ofile->size);
+}
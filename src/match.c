@@ -0,0 +1,267 @@
+#include "ofilep.h"
+
+typedef struct          s_step {
+    uint64_t            set[4];
+    bool                star;
+}                       t_step;
+
+typedef struct          s_glob {
+    t_step              *steps;
+    size_t              nsteps;
+}                       t_glob;
+
+typedef struct          s_prefix {
+    char                *text;
+    size_t              length;
+}                       t_prefix;
+
+struct                  s_match {
+    t_prefix            *prefixes;
+    size_t              nprefixes;
+    t_glob              *globs;
+    size_t              nglobs;
+    uint64_t            first[4];
+    bool                anyfirst;
+    t_dstr              key;
+};
+
+static void
+set_add (uint64_t set[4], uint8_t c) {
+
+    set[c >> 6] |= 1ULL << (c & 63);
+}
+
+static bool
+set_has (const uint64_t set[4], uint8_t c) {
+
+    return (set[c >> 6] >> (c & 63)) & 1;
+}
+
+static size_t
+bracket (const char *pattern, size_t k, uint64_t set[4]) {
+
+    const bool  negate = pattern[k + 1] == '!' || pattern[k + 1] == '^';
+    size_t      end = k + 1 + negate;
+    uint64_t    chars[4] = {0};
+
+    /* A ']' right after the opening bracket is one of the characters. Ranges go from one character to the next. */
+    do {
+
+        if (pattern[end] == '\\' && pattern[end + 1] != '\0') end++;
+        if (pattern[end] == '\0') return 0;
+
+        const uint8_t low = (uint8_t)pattern[end++];
+        uint8_t high = low;
+
+        if (pattern[end] == '-' && pattern[end + 1] != ']' && pattern[end + 1] != '\0') {
+
+            if (pattern[end + 1] == '\\' && pattern[end + 2] != '\0') end++;
+            high = (uint8_t)pattern[end + 1];
+            end += 2;
+        }
+
+        for (unsigned c = low; c <= high; c++) set_add(chars, (uint8_t)c);
+    } while (pattern[end] != ']');
+
+    for (int word = 0; word < 4; word++) set[word] = negate ? ~chars[word] : chars[word];
+    return end + 1;
+}
+
+static int
+push_prefix (t_match *match, const char *text, size_t length) {
+
+    t_prefix *prefixes = realloc(match->prefixes, (match->nprefixes + 1) * sizeof *prefixes);
+    if (prefixes == NULL) return EXIT_FAILURE;
+    match->prefixes = prefixes;
+
+    char *copy = malloc(length + 1);
+    if (copy == NULL) return EXIT_FAILURE;
+    ft_memcpy(copy, text, length);
+    copy[length] = '\0';
+
+    match->prefixes[match->nprefixes++] = (t_prefix){.text = copy, .length = length};
+    if (length == 0) match->anyfirst = true;
+    else set_add(match->first, (uint8_t)text[0]);
+    return EXIT_SUCCESS;
+}
+
+static int
+push_glob (t_match *match, t_step *steps, size_t nsteps) {
+
+    t_glob *globs = realloc(match->globs, (match->nglobs + 1) * sizeof *globs);
+    if (globs == NULL) return EXIT_FAILURE;
+    match->globs = globs;
+
+    match->globs[match->nglobs++] = (t_glob){.steps = steps, .nsteps = nsteps};
+    if (steps[0].star) match->anyfirst = true;
+    else for (int word = 0; word < 4; word++) match->first[word] |= steps[0].set[word];
+    return EXIT_SUCCESS;
+}
+
+static int
+compile (t_match *match, const char *pattern) {
+
+    const size_t    length = ft_strlen(pattern);
+    t_step          *steps = malloc((length + 1) * sizeof *steps);
+    char            *text = malloc(length + 1);
+    size_t          nsteps = 0;
+    size_t          nliteral = 0;
+    bool            wildcards = false;
+
+    if (steps == NULL || text == NULL) return free(steps), free(text), EXIT_FAILURE;
+
+    /*
+       Each step of a glob matches one character out of a set, or any number of them for a star. The characters the
+       glob starts with, up to its first wildcard, are also kept as text, for the globs that are only a prefix.
+    */
+
+    for (size_t k = 0; k < length; ) {
+
+        t_step  step = {0};
+        size_t  next = k + 1;
+
+        wildcards |= pattern[k] == '*' || pattern[k] == '?' || pattern[k] == '[' || pattern[k] == '\\';
+        if (pattern[k] == '*') {
+
+            k++;
+            if (nsteps == 0 || steps[nsteps - 1].star == false) steps[nsteps++] = (t_step){.star = true};
+            continue;
+        }
+
+        /* Unclosed brackets and trailing backslashes stand for themselves. */
+        if (pattern[k] == '?') ft_memset(step.set, 0xff, sizeof step.set);
+        else if (pattern[k] != '[' || (next = bracket(pattern, k, step.set)) == 0) {
+
+            if (pattern[k] == '\\' && k + 1 < length) k++;
+            next = k + 1;
+            set_add(step.set, (uint8_t)pattern[k]);
+            if (nliteral == nsteps) text[nliteral++] = pattern[k];
+        }
+
+        steps[nsteps++] = step;
+        k = next;
+    }
+
+    /* Patterns without wildcards, and globs that are only a prefix followed by a star, are matched as prefixes. */
+    int retcode;
+    if (wildcards == false || (nsteps == nliteral + 1 && steps[nliteral].star)) {
+
+        retcode = push_prefix(match, text, nliteral);
+        free(steps);
+    } else if ((retcode = push_glob(match, steps, nsteps)) != EXIT_SUCCESS) free(steps);
+
+    free(text);
+    return retcode;
+}
+
+static bool
+glob_match (const t_glob *glob, const char *name, size_t length) {
+
+    size_t step = 0, k = 0;
+    size_t star = SIZE_MAX, resume = 0;
+
+    /*
+       Characters are matched one step at a time. On a mismatch, the last star takes one more character and the steps
+       after it start over, which is enough as a star can stand for anything the later ones would have taken.
+    */
+
+    while (k < length) {
+
+        if (step < glob->nsteps && glob->steps[step].star) {
+
+            star = ++step;
+            resume = k;
+        } else if (step < glob->nsteps && set_has(glob->steps[step].set, (uint8_t)name[k])) {
+
+            step++;
+            k++;
+        } else if (star != SIZE_MAX) {
+
+            step = star;
+            k = ++resume;
+        } else return false;
+    }
+
+    while (step < glob->nsteps && glob->steps[step].star) step++;
+    return step == glob->nsteps;
+}
+
+bool
+match_name (const t_match *match, const char *name, size_t length) {
+
+    /* Most names are turned down by their first character, before any pattern is tried. */
+    if (match->anyfirst == false && set_has(match->first, (uint8_t)name[0]) == false) return false;
+
+    for (size_t k = 0; k < match->nprefixes; k++)
+        if (length >= match->prefixes[k].length
+            && ft_strncmp(name, match->prefixes[k].text, match->prefixes[k].length) == 0) return true;
+
+    for (size_t k = 0; k < match->nglobs; k++)
+        if (glob_match(&match->globs[k], name, length)) return true;
+
+    return false;
+}
+
+const char *
+match_key (const t_match *match) {
+
+    return match != NULL ? match->key.buff : "-";
+}
+
+void
+match_del (t_match *match) {
+
+    if (match == NULL) return;
+    for (size_t k = 0; k < match->nprefixes; k++) free(match->prefixes[k].text);
+    for (size_t k = 0; k < match->nglobs; k++) free(match->globs[k].steps);
+    free(match->prefixes);
+    free(match->globs);
+    free(match->key.buff);
+    free(match);
+}
+
+int
+match_args (int *argc, const char **argv, t_match **match) {
+
+    int kept = 1;
+
+    /*
+       The options parser only keeps the last value given to an option, so --match isn't one of its options: every
+       "--match PATTERN" and "--match=PATTERN" up to "--" is taken out of the arguments and compiled here. A "--match"
+       missing its pattern is left for the parser to refuse as an unknown option.
+    */
+
+    *match = NULL;
+    for (int k = 1; k < *argc; k++) {
+
+        const char *pattern = NULL;
+
+        if (ft_strequ(argv[k], "--")) {
+
+            while (k < *argc) argv[kept++] = argv[k++];
+            break;
+        }
+
+        if (ft_strnequ(argv[k], "--match=", 8)) pattern = argv[k] + 8;
+        else if (ft_strequ(argv[k], "--match") && k + 1 < *argc) pattern = argv[++k];
+        else {
+
+            argv[kept++] = argv[k];
+            continue;
+        }
+
+        if ((*match == NULL && (*match = calloc(1, sizeof(t_match))) == NULL)
+            || compile(*match, pattern) != EXIT_SUCCESS) {
+
+            match_del(*match);
+            *match = NULL;
+            return EXIT_FAILURE;
+        }
+
+        /* The patterns are part of what cached outputs depend on, with their lengths so they can't run together. */
+        ft_dstrfpush(&(*match)->key, "%lu:%s", (unsigned long)ft_strlen(pattern), pattern);
+    }
+
+    *argc = kept;
+    return EXIT_SUCCESS;
+}
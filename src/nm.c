@@ -1,13 +1,72 @@
 #include "ofilep.h"
 #include <mach-o/stab.h>
 
+#define NM_BLOCK 16384
+#define NM_LINE 64
+#define NM_SORT_PARALLEL 65536
+#define NM_SWAP_BLOCK 1024
+
 typedef struct      s_entry {
     const char      *name;
+    size_t          length;
+    uint64_t        key;
     uint8_t         n_type;
     uint8_t         n_sect;
+    uint32_t        shared;
     uint64_t        n_value;
 }                   t_entry;
 
+typedef struct      s_strtab {
+    uint32_t        stroff;
+    uint32_t        strsize;
+    size_t          end;
+    bool            terminated;
+}                   t_strtab;
+
+typedef struct      s_edge {
+    uint64_t        node;
+    const char      *label;
+    size_t          depth;
+}                   t_edge;
+
+typedef struct      s_trie {
+    const uint8_t   *start;
+    const uint8_t   *end;
+    t_edge          *stack;
+    size_t          nstack;
+    size_t          capacity;
+    char            *name;
+    size_t          length;
+    size_t          size;
+}                   t_trie;
+
+typedef struct      s_run {
+    size_t          left;
+    size_t          left_end;
+    size_t          right;
+    size_t          right_end;
+    size_t          out;
+}                   t_run;
+
+typedef struct      s_sort {
+    t_entry         *from;
+    t_entry         *to;
+    t_run           *runs;
+    size_t          nentries;
+    size_t          width;
+    int             (*cmp)(const void *, const void *);
+}                   t_sort;
+
+typedef struct      s_writer {
+    t_ofile         *ofile;
+    size_t          size;
+    char            block[NM_BLOCK];
+}                   t_writer;
+
+static const char   hexdigits[16] = {
+        '0', '1', '2', '3', '4', '5', '6', '7', '8', '9', 'a', 'b', 'c', 'd', 'e', 'f'
+};
+
 static const char   nosect[] = {
         [N_ABS] = 'A',
         [N_INDR] = 'I',
@@ -47,16 +106,38 @@ static const char   *stab[] = {
         [N_LENG] = "LENG"
 };
 
-static char         symbols[UINT8_MAX];
+static uint64_t
+prefix_key (const char *name, size_t length) {
+
+    uint64_t key = 0;
+
+    for (size_t k = 0; k < 8; k++) key = key << 8 | (k < length ? (uint8_t)name[k] : 0);
+    return key;
+}
+
+static int
+name_cmp (const t_entry *a, const t_entry *b) {
+
+    /*
+       Keys hold 8 bytes of the names past the prefix they all share, big endian and padded with zeroes, so they
+       compare the way the names do. Equal keys of a name that ends within its key mean equal names, otherwise the
+       rest of the names decides, from past the bytes already compared.
+    */
+
+    const size_t end = (size_t)a->shared + 8;
+
+    if (a->key != b->key) return a->key < b->key ? -1 : 1;
+    return a->length < end ? 0 : ft_strcmp(a->name + end, b->name + end);
+}
 
 static int
 regular_sort (const void *restrict a, const void *restrict b) {
 
-    /* If both entries have the same name, we sort numerically. */
-    if (ft_strequ(((t_entry *)a)->name, ((t_entry *)b)->name))
-        return ((t_entry *)a)->n_value >= ((t_entry *)b)->n_value;
+    const int cmp = name_cmp(a, b);
 
-    return ft_strcmp(((t_entry *)a)->name, ((t_entry *)b)->name) > 0;
+    /* If both entries have the same name, we sort numerically. */
+    if (cmp == 0) return ((t_entry *)a)->n_value >= ((t_entry *)b)->n_value;
+    return cmp > 0;
 }
 
 static int
@@ -64,11 +145,194 @@ numerical_sort (const void *restrict a, const void *restrict b) {
 
     /* Lexical sort for some entries with the same values. */
     if (((t_entry *)a)->n_value == ((t_entry *)b)->n_value && (((t_entry *)a)->n_type & N_TYPE) == N_UNDF)
-        return ft_strcmp(((t_entry *)a)->name, ((t_entry *)b)->name) > 0;
+        return name_cmp(a, b) > 0;
 
     return ((t_entry *)a)->n_value >= ((t_entry *)b)->n_value;
 }
 
+static void
+merge_sort (t_entry *entries, t_entry *tmp, const size_t nentries, int (*cmp)(const void *, const void *)) {
+
+    /*
+       Bottom-up merge sort. The comparators answer "does a go after b", so when merging we always ask it with the
+       later entry as a: the earlier entry only yields its place when the comparator says so, which keeps the sort
+       stable and gives the same order as the linked list insertion it replaces.
+    */
+
+    for (size_t width = 1; width < nentries; width *= 2) {
+
+        for (size_t left = 0; left < nentries; left += 2 * width) {
+
+            const size_t mid = (left + width < nentries) ? left + width : nentries;
+            const size_t right = (mid + width < nentries) ? mid + width : nentries;
+            size_t i = left, j = mid, k = left;
+
+            while (i < mid && j < right) tmp[k++] = cmp(&entries[j], &entries[i]) ? entries[i++] : entries[j++];
+            while (i < mid) tmp[k++] = entries[i++];
+            while (j < right) tmp[k++] = entries[j++];
+        }
+
+        ft_memcpy(entries, tmp, nentries * sizeof *entries);
+    }
+}
+
+static int
+value_key (const t_entry *a, const t_entry *b) {
+
+    return (a->n_value > b->n_value) - (a->n_value < b->n_value);
+}
+
+static void
+merge_run (const t_sort *sort, const t_run *run) {
+
+    /* The same merge as merge_sort's, from one buffer to the other. */
+    const t_entry *from = sort->from;
+    t_entry *to = sort->to + run->out;
+    size_t i = run->left, j = run->right;
+
+    while (i < run->left_end && j < run->right_end) *to++ = sort->cmp(&from[j], &from[i]) ? from[i++] : from[j++];
+    while (i < run->left_end) *to++ = from[i++];
+    while (j < run->right_end) *to++ = from[j++];
+}
+
+static void
+sort_chunk (void *ctx, size_t k) {
+
+    const t_sort *sort = ctx;
+    const size_t left = k * sort->width;
+    const size_t size = (sort->nentries - left < sort->width) ? sort->nentries - left : sort->width;
+
+    merge_sort(sort->from + left, sort->to + left, size, sort->cmp);
+}
+
+static void
+merge_task (void *ctx, size_t k) {
+
+    const t_sort *sort = ctx;
+
+    merge_run(sort, &sort->runs[k]);
+}
+
+static int
+merge_emit (void *ctx, size_t k) {
+
+    (void)ctx;
+    (void)k;
+    return EXIT_SUCCESS;
+}
+
+static size_t
+lower_bound (const t_entry *entries, size_t left, size_t right, const t_entry *pivot,
+        int (*key)(const t_entry *, const t_entry *)) {
+
+    while (left < right) {
+
+        const size_t mid = left + (right - left) / 2;
+
+        if (key(&entries[mid], pivot) < 0) left = mid + 1;
+        else right = mid;
+    }
+
+    return left;
+}
+
+static size_t
+split_merge (const t_entry *entries, t_run *runs, size_t left, size_t mid, size_t right, size_t nparts,
+        int (*key)(const t_entry *, const t_entry *)) {
+
+    /*
+       Both runs are sorted by the key, and the comparators only look further between entries of equal keys, so
+       entries with lower keys than a pivot always come before the others in the merge, whichever run they are from.
+       Cutting both runs at the same pivot key thus splits the merge in parts that give the same result as a whole.
+    */
+
+    const bool  larger = (mid - left >= right - mid);
+    size_t      a = left, b = mid, nruns = 0;
+
+    for (size_t part = 1; part <= nparts; part++) {
+
+        size_t next_a = mid, next_b = right;
+
+        if (part < nparts) {
+
+            const t_entry *pivot = larger
+                    ? &entries[left + (mid - left) * part / nparts]
+                    : &entries[mid + (right - mid) * part / nparts];
+
+            next_a = lower_bound(entries, a, mid, pivot, key);
+            next_b = lower_bound(entries, b, right, pivot, key);
+        }
+
+        if (next_a != a || next_b != b) runs[nruns++] = (t_run){.left = a, .left_end = next_a, .right = b,
+                .right_end = next_b, .out = a + b - mid};
+
+        a = next_a;
+        b = next_b;
+    }
+
+    return nruns;
+}
+
+static int
+parallel_sort (t_ofile *ofile, t_entry *entries, t_entry *tmp, const size_t nentries,
+        int (*cmp)(const void *, const void *), int (*key)(const t_entry *, const t_entry *)) {
+
+    const size_t nthreads = ofile->jobs;
+    size_t width = 1;
+
+    /*
+       Chunks are as many as threads, but their size is rounded up to a power of two, so that sorting them takes the
+       same merges as the first passes of merge_sort would. The passes that follow merge runs of twice the size as
+       long as there are more runs than threads. Once there are fewer, each merge is split in parts as well.
+    */
+
+    while (width * nthreads < nentries) width *= 2;
+
+    const size_t    nchunks = (nentries + width - 1) / width;
+    t_run           *runs = arena_alloc(ofile->arena, (nchunks + nthreads) * sizeof *runs);
+    t_sort          sort = {.from = entries, .to = tmp, .runs = runs, .nentries = nentries, .width = width, .cmp = cmp};
+    if (runs == NULL) return EXIT_FAILURE; /* E_RRNO */
+
+    pool_run(nchunks, ofile->jobs, sort_chunk, merge_emit, &sort);
+
+    for ( ; width < nentries; width *= 2) {
+
+        const size_t    npairs = (nentries + 2 * width - 1) / (2 * width);
+        const size_t    nparts = (npairs < nthreads) ? (nthreads + npairs - 1) / npairs : 1;
+        size_t          nruns = 0;
+
+        for (size_t left = 0; left < nentries; left += 2 * width) {
+
+            const size_t mid = (left + width < nentries) ? left + width : nentries;
+            const size_t right = (mid + width < nentries) ? mid + width : nentries;
+
+            nruns += split_merge(sort.from, runs + nruns, left, mid, right, nparts, key);
+        }
+
+        pool_run(nruns, ofile->jobs, merge_task, merge_emit, &sort);
+
+        t_entry *swap = sort.from;
+        sort.from = sort.to;
+        sort.to = swap;
+    }
+
+    /* Passes go back and forth between both buffers, the entries may have ended up in the scratch one. */
+    if (sort.from != entries) ft_memcpy(entries, sort.from, nentries * sizeof *entries);
+    return EXIT_SUCCESS;
+}
+
+static int
+sort_entries (t_ofile *ofile, t_entry *entries, t_entry *tmp, const size_t nentries,
+        int (*cmp)(const void *, const void *), int (*key)(const t_entry *, const t_entry *)) {
+
+    /* Below the cut-over, threads cost more than they save. */
+    if (ofile->jobs > 1 && nentries >= NM_SORT_PARALLEL)
+        return parallel_sort(ofile, entries, tmp, nentries, cmp, key);
+
+    merge_sort(entries, tmp, nentries, cmp);
+    return EXIT_SUCCESS;
+}
+
 static bool
 is_common (const uint8_t n_type, const uint64_t n_value) {
 
@@ -76,9 +340,32 @@ is_common (const uint8_t n_type, const uint64_t n_value) {
 }
 
 static void
-output (t_ofile *ofile, const t_object *object, const t_entry *entry) {
+flush_lines (t_writer *writer) {
 
-    const uint8_t type = (uint8_t)(entry->n_type & N_TYPE);
+    if (writer->size != 0) push_output(writer->ofile, writer->block, writer->size);
+    writer->size = 0;
+}
+
+static char *
+hex (char *out, uint64_t value, int width) {
+
+    for (int k = width - 1; k >= 0; k--, value >>= 4) out[k] = hexdigits[value & 0xf];
+    return out + width;
+}
+
+static void
+output (t_writer *writer, const t_ofile *ofile, const t_object *object, const t_entry *entry) {
+
+    const uint8_t   type = (uint8_t)(entry->n_type & N_TYPE);
+    const size_t    length = entry->length;
+
+    /*
+       Lines are laid out by hand into a block, which is pushed to the output once full. A name too long to fit in the
+       block is pushed on its own, right after what's in the block.
+    */
+
+    if (writer->size + NM_LINE + length > NM_BLOCK) flush_lines(writer);
+    char *out = writer->block + writer->size;
 
     /* If one of these two options is specified, we need merely to display the name. */
     if ((ofile->opt & NM_j) == 0 && (ofile->opt & NM_u) == 0) {
@@ -86,7 +373,7 @@ output (t_ofile *ofile, const t_object *object, const t_entry *entry) {
         /* Only retrieve the type from symbols if the symbol belongs to a section. */
         int letter;
         if (type != N_UNDF && type != N_ABS && type != N_INDR && (entry->n_type & N_STAB) == 0) {
-            letter = symbols[entry->n_sect];
+            letter = object->sections[entry->n_sect];
         } else if (is_common(entry->n_type, entry->n_value)) {
             letter = 'C';
         } else if (entry->n_type & N_STAB) {
@@ -95,64 +382,226 @@ output (t_ofile *ofile, const t_object *object, const t_entry *entry) {
             letter = nosect[type];
         }
 
-        if (type != N_UNDF || letter == 'C') {
-            ft_dstrfpush(ofile->buffer, "%.*lx", (object->is_64 ? 16 : 8), entry->n_value);
-        } else {
-            ft_dstrfpush(ofile->buffer, "%*c", (object->is_64 ? 16 : 8), ' ');
-        }
+        const int width = object->is_64 ? 16 : 8;
+        if (type != N_UNDF || letter == 'C') out = hex(out, entry->n_value, width);
+        else out = (char *)ft_memset(out, ' ', (size_t)width) + width;
 
-        ft_dstrfpush(ofile->buffer, " %c ", ((entry->n_type & N_EXT) == 0 ? ft_tolower(letter) : letter));
+        *out++ = ' ';
+        *out++ = (char)((entry->n_type & N_EXT) == 0 ? ft_tolower(letter) : letter);
+        *out++ = ' ';
 
         /* N_STAB debugging symbols detail. */
-        if (ofile->opt & NM_a && entry->n_type & N_STAB)
-            ft_dstrfpush(ofile->buffer, "%.2x %.4x %5s ", entry->n_sect, entry->n_type == N_OSO, stab[entry->n_type]);
+        if (ofile->opt & NM_a && entry->n_type & N_STAB) {
+
+            const char      *name = stab[entry->n_type] ? stab[entry->n_type] : "(null)";
+            const size_t    size = ft_strlen(name);
+
+            out = hex(out, entry->n_sect, 2);
+            *out++ = ' ';
+            out = hex(out, entry->n_type == N_OSO, 4);
+            *out++ = ' ';
+            for (size_t k = size; k < 5; k++) *out++ = ' ';
+            out = (char *)ft_memcpy(out, name, size) + size;
+            *out++ = ' ';
+        }
     }
 
-    ft_dstrfpush(ofile->buffer, "%s\n", entry->name);
+    writer->size = (size_t)(out - writer->block);
+    if (length + 1 > NM_BLOCK - writer->size) {
+
+        flush_lines(writer);
+        push_output(writer->ofile, entry->name, length);
+        push_output(writer->ofile, "\n", 1);
+        return;
+    }
+
+    ft_memcpy(writer->block + writer->size, entry->name, length);
+    writer->block[writer->size + length] = '\n';
+    writer->size += length + 1;
 }
 
-static int
-symtab (t_ofile *ofile, t_object *object, t_meta *meta, size_t offset) {
+OFILE_INLINE void
+symbol_range (const t_ofile *ofile, const t_object *object, const uint32_t nsyms, uint32_t range[2],
+        const bool is_cigam) {
+
+    const struct dysymtab_command *dysymtab = object->dysymtab;
+
+    /*
+       LC_DYSYMTAB splits the symbol table into local, external defined and undefined symbols, one range after the
+       other. With -g, -u or -U, only the ranges they can keep are read. Stabs are local, but they can look undefined
+       with -a -u, in which case everything is read.
+    */
+
+    range[0] = 0, range[1] = nsyms;
+    if (dysymtab == NULL || (ofile->opt & (NM_g | NM_u | NM_U)) == 0 || (ofile->opt & NM_a && ofile->opt & NM_u))
+        return;
+
+    const uint64_t nlocalsym = cswap_32(is_cigam, dysymtab->nlocalsym);
+    const uint64_t iextdefsym = cswap_32(is_cigam, dysymtab->iextdefsym);
+    const uint64_t iundefsym = cswap_32(is_cigam, dysymtab->iundefsym);
+
+    /* The ranges are only trusted if they follow each other and cover the whole table, otherwise everything is read. */
+    if (cswap_32(is_cigam, dysymtab->ilocalsym) != 0 || iextdefsym != nlocalsym
+        || iundefsym != iextdefsym + cswap_32(is_cigam, dysymtab->nextdefsym)
+        || iundefsym + cswap_32(is_cigam, dysymtab->nundefsym) != nsyms) return;
+
+    /* Common symbols are in the undefined range, and only objects can still have some. */
+    const uint32_t filetype = cswap_32(is_cigam, ((struct mach_header *)object->object)->filetype);
+    const bool locals = (ofile->opt & (NM_g | NM_u)) == 0;
+    const bool defined = (ofile->opt & NM_u) == 0;
+    const bool undefined = (ofile->opt & NM_U) == 0 || filetype == MH_OBJECT;
+
+    range[0] = (uint32_t)(locals ? 0 : defined ? iextdefsym : iundefsym);
+    range[1] = (uint32_t)(undefined ? nsyms : defined ? iundefsym : iextdefsym);
+    if (range[1] < range[0]) range[1] = range[0];
+}
+
+OFILE_INLINE const char *
+symbol_name (const t_ofile *ofile, const t_object *object, t_meta *meta, const t_strtab *strtab,
+        const uint32_t n_strx, size_t *length) {
+
+    if ((uint64_t)strtab->stroff + n_strx > object->size) {
+
+        meta->errcode = E_SYMSTRX;
+        /* The index is given past the end of the file, which a stream only knows once read to its end. */
+        meta->u_n.n_strindex = (int)(strtab->stroff + strtab->strsize + n_strx -
+                (ofile->stream != NULL ? stream_reach(ofile->stream, UINT64_MAX) : ofile->size));
+        return NULL;
+    }
+
+    /*
+       Names must end inside the string table, or inside the file for indexes past the table, which were always
+       let through. If the table ends with a NUL, every name starting inside it ends there, so a name is only scanned
+       when its length is needed.
+    */
+
+    const char *name = (const char *)object->object + strtab->stroff + n_strx;
+    if (length == NULL && n_strx < strtab->strsize && strtab->terminated) return name;
+
+    const size_t end = (n_strx < strtab->strsize) ? strtab->end : object->size;
+    const char *nul = ((size_t)strtab->stroff + n_strx < end)
+            ? memchr(name, '\0', end - strtab->stroff - n_strx)
+            : NULL;
+    if (nul == NULL) return (meta->errcode = E_SYMNAME), NULL;
+
+    if (length != NULL) *length = (size_t)(nul - name);
+    return name;
+}
+
+OFILE_INLINE int
+skip_symbols (const t_ofile *ofile, const t_object *object, t_meta *meta, const struct symtab_command *symtab,
+        const t_strtab *strtab, const uint32_t last, const bool is_64, const bool is_cigam) {
+
+    const size_t nlist_size = is_64 ? sizeof(struct nlist_64) : sizeof(struct nlist);
+
+    /* Symbols that aren't read go through the same checks as the ones that are, so errors are a full read's. */
+    for ( ; meta->u_k.k_strindex < last; meta->u_k.k_strindex++) {
+
+        const size_t offset = cswap_32(is_cigam, symtab->symoff) + meta->u_k.k_strindex * nlist_size;
+        const struct nlist_64 *nlist = (struct nlist_64 *)opeek(object, offset, sizeof *nlist);
+        if (nlist == NULL) return EXIT_FAILURE; /* E_RRNO */
+
+        if (symbol_name(ofile, object, meta, strtab, cswap_32(is_cigam, nlist->n_un.n_strx), NULL) == NULL)
+            return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
+
+OFILE_INLINE int
+symtab (t_ofile *ofile, t_object *object, t_meta *meta, size_t offset, const bool is_64,
+        const bool is_cigam) {
 
     const struct symtab_command *symtab = (struct symtab_command *)opeek(object, offset, sizeof *symtab);
     if (symtab == NULL) return EXIT_FAILURE; /* E_RRNO */
 
-    const uint32_t stroff = oswap_32(object, symtab->stroff);
-    const uint32_t strsize = oswap_32(object, symtab->strsize);
-    t_list *list = NULL;
-    offset = oswap_32(object, symtab->symoff);
+    const uint32_t stroff = cswap_32(is_cigam, symtab->stroff);
+    const uint32_t strsize = cswap_32(is_cigam, symtab->strsize);
+    const uint32_t nsyms = cswap_32(is_cigam, symtab->nsyms);
+    const size_t nlist_size = is_64 ? sizeof(struct nlist_64) : sizeof(struct nlist);
+    const size_t strend = ((size_t)stroff + strsize < object->size) ? (size_t)stroff + strsize : object->size;
+    const t_strtab strtab = {
+            .stroff = stroff,
+            .strsize = strsize,
+            .end = strend,
+            .terminated = strsize > 0 && strend == (size_t)stroff + strsize
+                    && ((const char *)object->object)[strend - 1] == '\0'
+    };
+    uint32_t range[2];
+
+    symbol_range(ofile, object, nsyms, range, is_cigam);
+    offset = cswap_32(is_cigam, symtab->symoff) + range[0] * nlist_size;
+
+    /*
+       Size our symbol array from the number of symbols to read. A corrupted header can announce far more symbols than
+       the file holds, in which case the loop below fails once it runs out of file, so don't allocate past that point.
+    */
+
+    size_t capacity = (offset < object->size) ? (object->size - offset) / nlist_size + 1 : 1;
+    if (capacity > range[1] - range[0]) capacity = range[1] - range[0];
+
+    t_entry *entries = arena_alloc(ofile->arena, (capacity ? capacity : 1) * 2 * sizeof *entries);
+    if (entries == NULL) return EXIT_FAILURE; /* E_RRNO */
 
-    for (meta->u_k.k_strindex = 0; meta->u_k.k_strindex < oswap_32(object, symtab->nsyms); meta->u_k.k_strindex++) {
+    /*
+       Byte-swapped tables are converted to the host's byte order NM_SWAP_BLOCK entries at a time, so the loop below
+       reads every table the same way. Only the entries the file holds are converted, reading past them fails as usual.
+    */
+
+    char *native = is_cigam ? arena_alloc(ofile->arena, NM_SWAP_BLOCK * nlist_size) : NULL;
+    if (is_cigam && native == NULL) return EXIT_FAILURE; /* E_RRNO */
+    const t_swap swap = is_cigam ? swap_kernel() : NULL;
+    const char *swapped = native;
+    size_t held = 0;
+
+    size_t nentries = 0;
+    size_t shared = 0;
+    meta->u_k.k_strindex = 0;
+    if (skip_symbols(ofile, object, meta, symtab, &strtab, range[0], is_64, is_cigam) != EXIT_SUCCESS)
+        return EXIT_FAILURE;
+    for ( ; meta->u_k.k_strindex < range[1]; meta->u_k.k_strindex++) {
 
         const struct nlist_64 *nlist = (struct nlist_64 *)opeek(object, offset, sizeof *nlist);
         if (nlist == NULL) return EXIT_FAILURE; /* E_RRNO */
+        if (is_cigam) {
 
-        const uint32_t n_strx = oswap_32(object, nlist->n_un.n_strx);
-        if (stroff + n_strx > object->size) {
+            if (held == 0) {
 
-            meta->errcode = E_SYMSTRX;
-            meta->u_n.n_strindex = (int)(stroff + strsize + n_strx - ofile->size);
-            return EXIT_FAILURE;
+                held = (object->size - offset) / nlist_size;
+                if (held > range[1] - meta->u_k.k_strindex) held = range[1] - meta->u_k.k_strindex;
+                if (held > NM_SWAP_BLOCK) held = NM_SWAP_BLOCK;
+                swap(native, nlist, held, is_64);
+                swapped = native;
+            }
+            nlist = (const struct nlist_64 *)swapped;
+            swapped += nlist_size;
+            held--;
         }
 
-        /* Increment the offset in case our symbol should not be inserted in the linked list. */
-        offset += (object->is_64 ? sizeof(struct nlist_64) : sizeof(struct nlist));
+        /* Name lengths are kept for the sort and the output. */
+        size_t length;
+        const char *name = symbol_name(ofile, object, meta, &strtab, nlist->n_un.n_strx, &length);
+        if (name == NULL) return EXIT_FAILURE;
+
+        /* Increment the offset in case our symbol should not be kept. */
+        offset += nlist_size;
 
         t_entry entry = {
-                .name = object->object + stroff + oswap_32(object, nlist->n_un.n_strx),
+                .name = name,
+                .length = length,
                 .n_sect = nlist->n_sect,
                 .n_type = nlist->n_type,
-                .n_value = (object->is_64
-                            ? oswap_64(object, nlist->n_value)
-                            : oswap_32(object, ((struct nlist *)nlist)->n_value))
+                .n_value = is_64 ? nlist->n_value : ((struct nlist *)nlist)->n_value
         };
 
         /*
-           Only insert the symbol in the linked list if the command line options match.
+           Only keep the symbol if the command line options match.
             -a: display N_STAB debugging entries
             -h: only display external symbols
             -u: only display undefined symbols
             -U: do not display undefined symbols
+            --defines: only display the definitions of the given symbol, common ones included
+            --match: only display the symbols matching one of the patterns
         */
 
         if ((nlist->n_type & N_STAB) && (ofile->opt & NM_a) == 0) continue;
@@ -162,52 +611,334 @@ symtab (t_ofile *ofile, t_object *object, t_meta *meta, size_t offset) {
         const bool common = is_common(entry.n_type, entry.n_value);
         if (ofile->opt & NM_u && ((nlist->n_type & N_TYPE) != N_UNDF || common == true)) continue;
         if ((nlist->n_type & N_TYPE) == N_UNDF && common == false && ofile->opt & NM_U) continue;
+        if (ofile->defines != NULL && (((nlist->n_type & N_TYPE) == N_UNDF && common == false)
+            || ft_strequ(entry.name, ofile->defines) == 0)) continue;
+        if (ofile->match != NULL && match_name(ofile->match, entry.name, entry.length) == false) continue;
 
-        t_list *link = ft_lstctor(&entry, sizeof(entry));
+        if (nentries == 0) shared = entry.length;
+        entries[nentries++] = entry;
 
-        /* Insert the link in our linked list depending on sorting option. */
-        if (ofile->opt & NM_n) ft_lstinsert(&list, link, numerical_sort, (ofile->opt & NM_r ? E_REV : E_REG));
-        else if (ofile->opt & NM_p) ft_lstappend(&list, link);
-        else ft_lstinsert(&list, link, regular_sort, (ofile->opt & NM_r ? E_REV : E_REG));
+        /* Keep track of the prefix all the names share, which would only waste the sort keys. */
+        size_t k = 0;
+        while (k < shared && entry.name[k] == entries[0].name[k]) k++;
+        shared = k;
     }
 
-    /* Go through out linked list to print the sorted symbols. Clean the list while we're at it. */
-    while (list != NULL) {
+    if (skip_symbols(ofile, object, meta, symtab, &strtab, nsyms, is_64, is_cigam) != EXIT_SUCCESS)
+        return EXIT_FAILURE;
+
+    /*
+       Sort keys hold the 8 bytes that follow the shared prefix. Names with equal keys are equal up to there, so the
+       comparisons that fall back to the names still give the same order.
+    */
+
+    if ((ofile->opt & NM_p) == 0 || ofile->opt & NM_n)
+        for (size_t k = 0; k < nentries; k++) {
+
+            entries[k].key = prefix_key(entries[k].name + shared, entries[k].length - shared);
+            entries[k].shared = (uint32_t)shared;
+        }
+
+    /* Sort depending on sorting option. The second half of our allocation is the merge scratch space. */
+    if (ofile->opt & NM_n) {
 
-        output(ofile, object, list->data);
-        t_list *tmp = list->next;
-        ft_memdtor(&list->data);
-        ft_memdtor((void **)&list);
-        list = tmp;
+        if (sort_entries(ofile, entries, entries + capacity, nentries, numerical_sort, value_key) != EXIT_SUCCESS)
+            return EXIT_FAILURE; /* E_RRNO */
+    } else if ((ofile->opt & NM_p) == 0) {
+
+        if (sort_entries(ofile, entries, entries + capacity, nentries, regular_sort, name_cmp) != EXIT_SUCCESS)
+            return EXIT_FAILURE; /* E_RRNO */
     }
 
+    /* Print the sorted symbols, backwards for -r (which -p ignores). */
+    const bool  reverse = (ofile->opt & NM_r) && ((ofile->opt & NM_n) || (ofile->opt & NM_p) == 0);
+    t_writer    *writer = arena_alloc(ofile->arena, sizeof(t_writer));
+    if (writer == NULL) return EXIT_FAILURE; /* E_RRNO */
+
+    writer->ofile = ofile;
+    writer->size = 0;
+    for (size_t k = 0; k < nentries; k++) output(writer, ofile, object, &entries[reverse ? nentries - k - 1 : k]);
+    flush_lines(writer);
+
+    /* Both the entries and the writer go back to the arena once the object is done. */
     return EXIT_SUCCESS;
 }
 
-static int
-segment (t_ofile *ofile, t_object *object, t_meta *meta, size_t offset) {
+OFILE_SPECIALIZE(symtab, (t_ofile *ofile, t_object *object, t_meta *meta, size_t offset),
+        (ofile, object, meta, offset))
+
+static void
+put (t_writer *writer, const char *data, size_t size) {
+
+    while (size > 0) {
+
+        if (writer->size == NM_BLOCK) flush_lines(writer);
+        const size_t chunk = (size < NM_BLOCK - writer->size) ? size : NM_BLOCK - writer->size;
+
+        ft_memcpy(writer->block + writer->size, data, chunk);
+        writer->size += chunk;
+        data += chunk;
+        size -= chunk;
+    }
+}
+
+static bool
+uleb128 (const uint8_t **data, const uint8_t *end, uint64_t *value) {
+
+    unsigned shift = 0;
+
+    *value = 0;
+    do {
+
+        if (*data == end || shift > 63) return false;
+        *value |= (uint64_t)(**data & 0x7f) << shift;
+        shift += 7;
+    } while (*(*data)++ & 0x80);
+
+    return true;
+}
+
+static bool
+export_line (t_writer *writer, const t_ofile *ofile, const t_object *object, const t_trie *trie,
+        const uint8_t *info, const uint8_t *end) {
+
+    uint64_t    flags, address = 0, other;
+    const char  *import = NULL;
+    char        line[NM_LINE];
+    char        *out = line;
+
+    /* Terminal nodes hold the flags, then either the address or what the symbol is re-exported from. */
+    if (uleb128(&info, end, &flags) == false) return false;
+    if (flags & EXPORT_SYMBOL_FLAGS_REEXPORT) {
+
+        if (uleb128(&info, end, &other) == false || memchr(info, '\0', (size_t)(end - info)) == NULL) return false;
+        import = (const char *)info;
+    } else if (uleb128(&info, end, &address) == false
+        || (flags & EXPORT_SYMBOL_FLAGS_STUB_AND_RESOLVER && uleb128(&info, end, &other) == false)) return false;
+
+    if (ofile->defines != NULL && (ft_strlen(ofile->defines) != trie->length
+        || ft_strncmp(ofile->defines, trie->name, trie->length) != 0)) return true;
+    if (ofile->match != NULL && match_name(ofile->match, trie->name, trie->length) == false) return true;
+
+    /* Addresses are relative to the image, absolute symbols aside. Re-exported symbols have none. */
+    if ((ofile->opt & NM_j) == 0) {
+
+        const int width = object->is_64 ? 16 : 8;
+
+        if ((flags & EXPORT_SYMBOL_FLAGS_KIND_MASK) != EXPORT_SYMBOL_FLAGS_KIND_ABSOLUTE) address += object->base;
+        if (import != NULL) out = (char *)ft_memset(out, ' ', (size_t)width) + width;
+        else out = hex(out, address, width);
+        *out++ = ' ';
+    }
+
+    put(writer, line, (size_t)(out - line));
+    put(writer, trie->name, trie->length);
+
+    if ((ofile->opt & NM_j) == 0) {
+
+        const char *kind = NULL;
 
-    (void)ofile;
+        if (import != NULL) kind = " [re-export]";
+        else if ((flags & EXPORT_SYMBOL_FLAGS_KIND_MASK) == EXPORT_SYMBOL_FLAGS_KIND_ABSOLUTE) kind = " [absolute]";
+        else if ((flags & EXPORT_SYMBOL_FLAGS_KIND_MASK) == EXPORT_SYMBOL_FLAGS_KIND_THREAD_LOCAL) kind = " [tlv]";
+        if (kind != NULL) put(writer, kind, ft_strlen(kind));
+        if (flags & EXPORT_SYMBOL_FLAGS_WEAK_DEFINITION) put(writer, " [weak]", 7);
+        if (flags & EXPORT_SYMBOL_FLAGS_STUB_AND_RESOLVER) put(writer, " [resolver]", 11);
+        if (import != NULL && *import != '\0') {
+
+            put(writer, " (", 2);
+            put(writer, import, ft_strlen(import));
+            put(writer, ")", 1);
+        }
+    }
+
+    put(writer, "\n", 1);
+    return true;
+}
+
+static bool
+trie_push (t_ofile *ofile, t_trie *trie, const uint8_t **children, const size_t depth) {
+
+    /* Each edge is a NUL-terminated label followed by the offset of the node it leads to. */
+    const uint8_t *label = *children;
+    const uint8_t *nul = memchr(label, '\0', (size_t)(trie->end - label));
+    uint64_t node;
+
+    if (nul == NULL) return false;
+    *children = nul + 1;
+    if (uleb128(children, trie->end, &node) == false || node >= (uint64_t)(trie->end - trie->start)) return false;
+
+    if (trie->nstack == trie->capacity) {
+
+        const size_t capacity = trie->capacity ? trie->capacity * 2 : 256;
+        t_edge *stack = arena_grow(ofile->arena, trie->stack, trie->capacity * sizeof *stack, capacity * sizeof *stack);
+
+        if (stack == NULL) return false;
+        trie->stack = stack;
+        trie->capacity = capacity;
+    }
+
+    trie->stack[trie->nstack++] = (t_edge){.node = node, .label = (const char *)label, .depth = depth};
+    return true;
+}
+
+static bool
+trie_children (t_ofile *ofile, t_trie *trie, const uint8_t *children, const size_t depth) {
+
+    const uint8_t nchildren = *children++;
+
+    for (uint8_t k = 0; k < nchildren; k++)
+        if (trie_push(ofile, trie, &children, depth) == false) return false;
+
+    return true;
+}
+
+static bool
+trie_name (t_ofile *ofile, t_trie *trie, const t_edge *edge) {
+
+    const size_t size = ft_strlen(edge->label);
+
+    /* Siblings only share the name up to their depth, so each edge writes its label from there. */
+    if (edge->depth + size > trie->size) {
+
+        const size_t grown = (edge->depth + size) * 2 + 64;
+        char *name = arena_grow(ofile->arena, trie->name, trie->size, grown);
+
+        if (name == NULL) return false;
+        trie->name = name;
+        trie->size = grown;
+    }
+
+    ft_memcpy(trie->name + edge->depth, edge->label, size);
+    trie->length = edge->depth + size;
+    return true;
+}
+
+OFILE_INLINE int
+exports (t_ofile *ofile, t_object *object, t_meta *meta, size_t offset, const bool is_64, const bool is_cigam) {
+
+    (void)is_64;
+    const struct dyld_info_command *dyld_info = (struct dyld_info_command *)opeek(object, offset, sizeof *dyld_info);
+    const struct linkedit_data_command *linkedit = (struct linkedit_data_command *)opeek(object, offset,
+            sizeof *linkedit);
+    if (linkedit == NULL) return (meta->errcode = E_TRIE), EXIT_FAILURE;
+
+    /* The trie is found either in the dyld info, or in a command of its own. */
+    const bool is_trie = cswap_32(is_cigam, linkedit->cmd) == LC_DYLD_EXPORTS_TRIE;
+    if (is_trie == false && dyld_info == NULL) return (meta->errcode = E_TRIE), EXIT_FAILURE;
+
+    const uint64_t trieoff = cswap_32(is_cigam, is_trie ? linkedit->dataoff : dyld_info->export_off);
+    const uint64_t triesize = cswap_32(is_cigam, is_trie ? linkedit->datasize : dyld_info->export_size);
+    if (trieoff + triesize > object->size) return (meta->errcode = E_TRIE), EXIT_FAILURE;
+    if (triesize == 0) return EXIT_SUCCESS;
+
+    t_trie      trie = {.start = (const uint8_t *)object->object + trieoff};
+    t_writer    *writer = arena_alloc(ofile->arena, sizeof(t_writer));
+    const char  *root = "";
+    if (writer == NULL) return EXIT_FAILURE; /* E_RRNO */
+
+    trie.end = trie.start + triesize;
+    writer->ofile = ofile;
+    writer->size = 0;
+
+    /*
+       The trie is walked depth first with a stack of edges rather than by recursion. The children of a node are
+       pushed in reverse order of their labels, which start with distinct bytes, so names come out in lexical order,
+       each before the longer names it prefixes. A node can't be visited more times than the trie has bytes, any more
+       and the trie has a cycle.
+    */
+
+    trie.stack = arena_alloc(ofile->arena, 256 * sizeof *trie.stack);
+    trie.name = arena_alloc(ofile->arena, 256);
+    if (trie.stack == NULL || trie.name == NULL) return EXIT_FAILURE; /* E_RRNO */
+    trie.capacity = 256;
+    trie.size = 256;
+    trie.stack[trie.nstack++] = (t_edge){.node = 0, .label = root, .depth = 0};
+
+    for (uint64_t visits = 0; trie.nstack > 0; visits++) {
+
+        const t_edge edge = trie.stack[--trie.nstack];
+        const uint8_t *node = trie.start + edge.node;
+        uint64_t size;
+
+        if (visits == triesize || trie_name(ofile, &trie, &edge) == false || uleb128(&node, trie.end, &size) == false
+            || size >= (uint64_t)(trie.end - node)) return (meta->errcode = E_TRIE), EXIT_FAILURE;
+        if (size != 0 && export_line(writer, ofile, object, &trie, node, node + size) == false)
+            return (meta->errcode = E_TRIE), EXIT_FAILURE;
+
+        const size_t first = trie.nstack;
+        if (trie_children(ofile, &trie, node + size, trie.length) == false)
+            return (meta->errcode = E_TRIE), EXIT_FAILURE;
+
+        /*
+           An edge with an empty label only splits a node in two. The node it leads to has the same name, which is a
+           prefix of all the others, so its symbol comes right away and its children are sorted with their siblings.
+        */
+
+        for (size_t k = first; k < trie.nstack;) {
+
+            const uint8_t *split = trie.start + trie.stack[k].node;
+
+            if (*trie.stack[k].label != '\0') {
+
+                k++;
+                continue;
+            }
+
+            trie.stack[k] = trie.stack[--trie.nstack];
+            if (++visits == triesize || uleb128(&split, trie.end, &size) == false
+                || size >= (uint64_t)(trie.end - split)
+                || (size != 0 && export_line(writer, ofile, object, &trie, split, split + size) == false)
+                || trie_children(ofile, &trie, split + size, trie.length) == false)
+                return (meta->errcode = E_TRIE), EXIT_FAILURE;
+        }
+
+        /* Sort the children last label first, so the first one is on top of the stack. */
+        for (size_t k = first + 1; k < trie.nstack; k++) {
+
+            for (size_t j = k; j > first && ft_strcmp(trie.stack[j - 1].label, trie.stack[j].label) < 0; j--) {
+
+                const t_edge tmp = trie.stack[j];
+                trie.stack[j] = trie.stack[j - 1];
+                trie.stack[j - 1] = tmp;
+            }
+        }
+    }
+
+    flush_lines(writer);
+    return EXIT_SUCCESS;
+}
+
+OFILE_SPECIALIZE(exports, (t_ofile *ofile, t_object *object, t_meta *meta, size_t offset),
+        (ofile, object, meta, offset))
+
+OFILE_INLINE int
+segment (t_ofile *ofile, t_object *object, t_meta *meta, size_t offset, const bool is_64,
+        const bool is_cigam) {
+
+    (void)ofile, (void)is_64;
     struct segment_command *segment = (struct segment_command *)opeek(object, offset, sizeof *segment);
     if (segment == NULL) return (meta->errcode = E_GARBAGE), EXIT_FAILURE;
-    if (oswap_32(object, segment->fileoff) + oswap_32(object, segment->filesize) > object->size) {
+    if (cswap_32(is_cigam, segment->fileoff) + cswap_32(is_cigam, segment->filesize) > object->size) {
 
         meta->errcode = E_SEGOFF;
-        meta->command = oswap_32(object, segment->cmd);
+        meta->command = cswap_32(is_cigam, segment->cmd);
         return EXIT_FAILURE;
     }
 
+    if (ft_strequ(segment->segname, SEG_TEXT)) object->base = cswap_32(is_cigam, segment->vmaddr);
+
     offset += sizeof *segment;
-    const uint32_t nsects = oswap_32(object, segment->nsects);
+    const uint32_t nsects = cswap_32(is_cigam, segment->nsects);
     for (uint32_t k = 0; k < nsects; k++) {
 
         const struct section *section = (struct section *)opeek(object, offset, sizeof *section);
         if (section == NULL) return (meta->errcode = E_GARBAGE), EXIT_FAILURE;
 
-        if (ft_strequ(section->sectname, SECT_BSS)) symbols[object->k_sect] = 'B';
-        else if (ft_strequ(section->sectname, SECT_DATA)) symbols[object->k_sect] = 'D';
-        else if (ft_strequ(section->sectname, SECT_TEXT)) symbols[object->k_sect] = 'T';
-        else symbols[object->k_sect] = 'S';
+        if (ft_strequ(section->sectname, SECT_BSS)) object->sections[object->k_sect] = 'B';
+        else if (ft_strequ(section->sectname, SECT_DATA)) object->sections[object->k_sect] = 'D';
+        else if (ft_strequ(section->sectname, SECT_TEXT)) object->sections[object->k_sect] = 'T';
+        else object->sections[object->k_sect] = 'S';
 
         object->k_sect += 1;
         offset += sizeof *section;
@@ -216,30 +947,36 @@ segment (t_ofile *ofile, t_object *object, t_meta *meta, size_t offset) {
     return EXIT_SUCCESS;
 }
 
-static int
-segment_64 (t_ofile *ofile, t_object *object, t_meta *meta, size_t offset) {
+OFILE_SPECIALIZE(segment, (t_ofile *ofile, t_object *object, t_meta *meta, size_t offset),
+        (ofile, object, meta, offset))
 
-    (void)ofile;
+OFILE_INLINE int
+segment_64 (t_ofile *ofile, t_object *object, t_meta *meta, size_t offset, const bool is_64,
+        const bool is_cigam) {
+
+    (void)ofile, (void)is_64;
     struct segment_command_64 *segment = (struct segment_command_64 *)(object->object + offset);
     if (segment == NULL) return (meta->errcode = E_GARBAGE), EXIT_FAILURE;
-    if (oswap_64(object, segment->fileoff) + oswap_64(object, segment->filesize) > object->size) {
+    if (cswap_64(is_cigam, segment->fileoff) + cswap_64(is_cigam, segment->filesize) > object->size) {
 
         meta->errcode = E_SEGOFF;
-        meta->command = oswap_32(object, segment->cmd);
+        meta->command = cswap_32(is_cigam, segment->cmd);
         return EXIT_FAILURE;
     }
 
+    if (ft_strequ(segment->segname, SEG_TEXT)) object->base = cswap_64(is_cigam, segment->vmaddr);
+
     offset += sizeof *segment;
-    const uint32_t nsects = oswap_32(object, segment->nsects);
+    const uint32_t nsects = cswap_32(is_cigam, segment->nsects);
     for (uint32_t k = 0; k < nsects; k++) {
 
         const struct section_64 *section = (struct section_64 *)opeek(object, offset, sizeof *section);
         if (section == NULL) return (meta->errcode = E_GARBAGE), EXIT_FAILURE;
 
-        if (ft_strequ(section->sectname, SECT_BSS)) symbols[object->k_sect] = 'B';
-        else if (ft_strequ(section->sectname, SECT_DATA)) symbols[object->k_sect] = 'D';
-        else if (ft_strequ(section->sectname, SECT_TEXT)) symbols[object->k_sect] = 'T';
-        else symbols[object->k_sect] = 'S';
+        if (ft_strequ(section->sectname, SECT_BSS)) object->sections[object->k_sect] = 'B';
+        else if (ft_strequ(section->sectname, SECT_DATA)) object->sections[object->k_sect] = 'D';
+        else if (ft_strequ(section->sectname, SECT_TEXT)) object->sections[object->k_sect] = 'T';
+        else object->sections[object->k_sect] = 'S';
 
         object->k_sect += 1;
         offset += sizeof *section;
@@ -248,22 +985,30 @@ segment_64 (t_ofile *ofile, t_object *object, t_meta *meta, size_t offset) {
     return EXIT_SUCCESS;
 }
 
+OFILE_SPECIALIZE(segment_64, (t_ofile *ofile, t_object *object, t_meta *meta, size_t offset),
+        (ofile, object, meta, offset))
+
 int
 main (int argc, const char *argv[]) {
 
     int             index = 1;
-    static t_dstr   buffer;
-    static t_meta   meta = {
+    const char      *jobs = NULL;
+    const char      *address = NULL;
+    const char      *prefetch = NULL;
+    t_match         *match = NULL;
+    int             retcode;
+    static int      (*const reader[][4])(t_ofile *, t_object *, t_meta *, size_t) = {
+            [LC_SYMTAB] = OFILE_VARIANTS(symtab),
+            [LC_SEGMENT] = OFILE_VARIANTS(segment),
+            [LC_SEGMENT_64] = OFILE_VARIANTS(segment_64),
+            [LC_DYLD_INFO] = OFILE_VARIANTS(exports)
+    };
+    t_meta          meta = {
             .obin = FT_NM,
-            .reader = {
-                    [LC_SYMTAB] = symtab,
-                    [LC_SEGMENT] = segment,
-                    [LC_SEGMENT_64] = segment_64
-            }
+            .reader = reader
     };
     t_ofile          ofile = {
             .arch = NULL,
-            .buffer = &buffer,
             .opt = 0
     };
     const t_opt      opts[] = {
@@ -276,43 +1021,67 @@ main (int argc, const char *argv[]) {
             {FT_OPT_BOOLEAN, 'r', "reverse-sort", &ofile.opt, "Sort in reverse order.", NM_r},
             {FT_OPT_BOOLEAN, 'u', "only-undefined", &ofile.opt, "Display only undefined symbols.", NM_u},
             {FT_OPT_BOOLEAN, 'U', "no-undefined", &ofile.opt, "Don't display undefined symbols.", NM_U},
+            {FT_OPT_BOOLEAN, 0, "exports", &ofile.opt, "Display the symbols exported by dylibs, read from their "
+                "export trie rather than their symbol table, in lexical order. Only -j, --defines and --match apply.",
+                NM_EXPORTS},
+            {FT_OPT_BOOLEAN, 0, "dedup", &ofile.opt, "List fat slices and archive members identical to one listed "
+                "before from what was printed for it, and report how many were.", DEDUP_OUTPUT},
             {FT_OPT_STRING, 'A', "arch", &ofile.arch, "Specifies the architecture of the file to display when the file "
                 "is a fat binary. \"all\" can be specified to display all architectures in the file. The default is to "
                 "display only the host architecture.", 0},
+            {FT_OPT_STRING, 0, "defines", &ofile.defines, "Only display the definitions of the symbol SYM. In "
+                "archives, only the members that define it according to the archive's symbol table are read.", 0},
+            {FT_OPT_STRING, 0, "jobs", &jobs, "Process up to N files in parallel, and sort large symbol tables with up "
+                "to N threads. Output is still printed in the order the files were given.", 0},
+            {FT_OPT_STRING, 0, "prefetch", &prefetch, "Map and read ahead up to N of the files that follow the ones "
+                "being read, in the background. 0 turns it off, the default is 8.", 0},
+            {FT_OPT_STRING, 'R', "recursive", &ofile.tree, "Also process the objects found in DIR and the directories "
+                "under it, in name order. Files that aren't objects, fat files or archives are skipped.", 0},
+            {FT_OPT_STRING, 0, "cache", &ofile.cache, "Keep the output of each file in DIR, and reuse it for as long "
+                "as the file and the options don't change.", 0},
+            {FT_OPT_STRING, 0, "serve", &address, "Answer requests read from a UNIX socket at ADDRESS, or from stdin "
+                "if ADDRESS is \"-\". A request is a line of options and files, the options given here are its "
+                "defaults. Requests can't give --prefetch, --serve nor --cache. The socket is only open to the user "
+                "running the server.", 0},
             {FT_OPT_END, 0, 0, 0, 0, 0}
     };
 
+    if (match_args(&argc, argv, &match) != EXIT_SUCCESS)
+        return ft_fprintf(stderr, "%s: %s\n", argv[0], strerror(errno)), EXIT_FAILURE;
     if (ft_optparse(opts, &index, argc, (char **)argv)) {
 
-        ft_optusage(opts, (char *)argv[0], "[file(s)]", "Dump symbols from [file(s)] (a.out by default).");
+        ft_optusage(opts, (char *)argv[0], "[--match PATTERN]... [file(s)]", "Dump symbols from [file(s)] (a.out by "
+                "default). --match only displays the symbols matching one of the PATTERNs, a glob if it has any of "
+                "*?[\\, and a prefix of the names otherwise.");
         return EXIT_FAILURE;
     };
 
-    if (argc == index) argv[argc++] = "a.out";
+    if (argc == index && ofile.tree == NULL) argv[argc++] = "a.out";
     if (ofile.arch && ft_strequ(ofile.arch, "all") == 0 && NXGetArchInfoFromName(ofile.arch) == NULL) {
 
         ft_fprintf(stderr, "%1$s: for the -arch option: Unknown architecture named \'%2$s\'.\n%1$s: %3$s: No "
-                "architecture specified.\n", argv[0], ofile.arch, argv[index]);
+                "architecture specified.\n", argv[0], ofile.arch, argc > index ? argv[index] : ofile.tree);
         return EXIT_FAILURE;
     }
+    if (jobs && ft_atoi(jobs) < 1)
+        return ft_fprintf(stderr, "%s: invalid number of jobs: \'%s\'\n", argv[0], jobs), EXIT_FAILURE;
+    if (prefetch && ft_atoi(prefetch) < 0)
+        return ft_fprintf(stderr, "%s: invalid prefetch depth: \'%s\'\n", argv[0], prefetch), EXIT_FAILURE;
+    ofile.prefetch = prefetch ? (unsigned)ft_atoi(prefetch) : PREFETCH_DEPTH;
 
-    /* Only output file name if there are multiple files. */
-    if (argc - 1 > index) ofile.opt |= NAME_OUTPUT;
+    if (ofile.cache && cache_init(ofile.cache) == EXIT_FAILURE)
+        return ft_fprintf(stderr, "%s: %s: %s\n", argv[0], ofile.cache, strerror(errno)), EXIT_FAILURE;
 
-    int retcode = EXIT_SUCCESS;
     meta.bin = argv[0];
-    for ( ; index < argc; index++) {
-
-        meta.path = argv[index];
-        meta.errcode = E_RRNO;
-        meta.type = E_MACHO;
-        if (open_file(&ofile, &meta) != EXIT_SUCCESS) {
+    ofile.match = match;
+    if (address != NULL) retcode = serve(&ofile, &meta, opts, address, jobs ? (unsigned)ft_atoi(jobs) : 1);
+    else {
 
-            /* nm doesn't return if the binary is not a valid object. */
-            printerr(&meta);
-            retcode = EXIT_FAILURE;
-        }
+        /* Only output file name if there are multiple files, or files found in a tree. */
+        if (argc - 1 > index || ofile.tree != NULL) ofile.opt |= NAME_OUTPUT;
+        retcode = open_files(&ofile, &meta, argv + index, (size_t)(argc - index), jobs ? (unsigned)ft_atoi(jobs) : 1);
     }
 
+    match_del(match);
     return retcode;
 }
@@ -1,13 +1,12 @@
 #include "ofilep.h"
 #include <ar.h>
-#include <fcntl.h>
 #include <mach-o/fat.h>
 #include <mach-o/ranlib.h>
-#include <sys/mman.h>
-#include <sys/stat.h>
 
 #define ERR_XTEND "extends past the end of the file)\n"
 #define SAR_EFMT1 3
+#define SYMDEF_OFFSETS 64
+#define OUTPUT_BOUND (256UL << 10)
 #define STRINGIFY(x) #x
 #define STR(x) STRINGIFY(x)
 
@@ -24,7 +23,9 @@ static const char       *errors[] = {
         [E_LOADOFF] = "extends past the end all load commands in the file",
         [E_SEGOFF] = "fileoff field plus filesize field",
         [E_FATOFF] = "offset plus size of",
-        [E_SYMSTRX] = "bad string table index"
+        [E_SYMSTRX] = "bad string table index",
+        [E_SYMNAME] = "symbol name not NUL-terminated inside the string table",
+        [E_TRIE] = "export trie malformed or extends past the end of the file"
 };
 
 static const size_t     header_size[] = {
@@ -44,57 +45,202 @@ static const char       *segcodes[] = {
 };
 
 
-int
-printerr (const t_meta *meta) {
+typedef struct          s_job {
+    t_dstr              buffer;
+    t_dstr              output;
+    t_dstr              errors;
+    t_splits            splits;
+    int                 retcode;
+    uint8_t             errcode;
+    bool                stored;
+}                       t_job;
+
+static void
+clear_job (t_job *job) {
+
+    free(job->buffer.buff), free(job->output.buff), free(job->errors.buff), free(job->splits.ends);
+    job->buffer.buff = job->output.buff = job->errors.buff = NULL;
+    job->splits = (t_splits){0};
+}
+
+typedef struct          s_unit {
+    t_object            object;
+    t_meta              meta;
+    t_job               job;
+    const char          *arch;
+}                       t_unit;
+
+typedef struct          s_units {
+    t_ofile             *ofile;
+    t_ofile             base;
+    t_meta              *meta;
+    t_unit              *units;
+    bool                deferred;
+    bool                keep_going;
+}                       t_units;
+
+const char *
+of_strerror (int errcode) {
+
+    /* The text nm and otool print for an error, without the details they add around it. */
+    if (errcode < 0 || (size_t)errcode >= sizeof errors / sizeof *errors) return NULL;
+    return errors[errcode];
+}
+
+static void
+split_output (const t_ofile *ofile) {
+
+    t_splits    *splits = ofile->splits;
+    size_t      *ends;
+
+    /* A split that can't be kept only moves the error after the output that follows it. */
+    if (splits->count == splits->capacity) {
+
+        const size_t capacity = splits->capacity ? splits->capacity * 2 : 8;
+        if ((ends = realloc(splits->ends, capacity * 2 * sizeof *ends)) == NULL) return;
+
+        splits->ends = ends;
+        splits->capacity = capacity;
+    }
+
+    splits->ends[splits->count * 2] = ofile->output->len;
+    splits->ends[splits->count * 2 + 1] = ofile->errors->len;
+    splits->count++;
+}
+
+static int
+printerr (const t_ofile *ofile, const t_meta *meta) {
+
+    t_dstr *err = ofile->errors;
 
     if (meta->errcode == E_RRNO) {
 
-        ft_fprintf(stderr, "%s: \'%s\': %s\n", meta->bin, meta->path, strerror(errno));
-        return EXIT_FAILURE;
+        ft_dstrfpush(err, "%s: \'%s\': %s\n", meta->bin, meta->path, strerror(errno));
+    } else if (meta->errcode < E_INV4L) {
+
+        ft_dstrfpush(err, "%s: %s\n", meta->path, errors[meta->errcode]);
+    } else {
+
+        ft_dstrfpush(err, "%s: \'%s\': %s %s ", meta->bin, meta->path, errors[0], filecodes[meta->type]);
+        switch (meta->errcode) {
+            case E_INV4L:
+                ft_dstrfpush(err, "(load command %u %s %d)\n", meta->k_command, errors[meta->errcode],
+                        meta->arch ? 8 : 4);
+                break;
+            case E_ARFMAG:
+                ft_dstrfpush(err, "(%s %s values for the archive member header for %s)\n",
+                        errors[meta->errcode], STR(ARFMAG), meta->ar_member);
+                break;
+            case E_AROFFSET:
+                ft_dstrfpush(err, "(%s %s)\n", errors[meta->errcode], meta->ar_member);
+                break;
+            case E_AROVERLAP:
+            case E_TRIE:
+                ft_dstrfpush(err, "(%s)\n", errors[meta->errcode]);
+                break;
+            case E_LOADOFF:
+                ft_dstrfpush(err, "(load command %u %s)\n", meta->k_command + 1, errors[meta->errcode]);
+                break;
+            case E_SEGOFF:
+                ft_dstrfpush(err, "(load command %u %s in %s %s", meta->k_command, errors[meta->errcode],
+                        segcodes[meta->command], ERR_XTEND);
+                break;
+            case E_FATOFF:
+                ft_dstrfpush(err, "(%s cputype (%d) cpusubtype (%d) %s", errors[meta->errcode],
+                        meta->u_n.n_cpu, meta->u_k.k_cpu, ERR_XTEND);
+                break;
+            case E_SYMNAME:
+                ft_dstrfpush(err, "(%s, for symbol at index %u)\n", errors[meta->errcode], meta->u_k.k_strindex);
+                break;
+            case E_SYMSTRX:
+            default:
+                ft_dstrfpush(err, "(%s: %d past the end of string table, for symbol at index %u)\n",
+                        errors[meta->errcode], meta->u_n.n_strindex, meta->u_k.k_strindex);
+        }
+
+        /* Because nm is so fancy, it prints an addional newline for some reason. */
+        if (meta->obin == FT_NM) ft_dstrfpush(err, "\n");
     }
 
-    if (meta->errcode < E_INV4L) {
+    /*
+       When running jobs, errors are kept with the file's output until it's its turn to be printed, along with where
+       they go in it.
+    */
+
+    if (ofile->output == NULL) {
 
-        ft_fprintf(stderr, "%s: %s\n", meta->path, errors[meta->errcode]);
-        return EXIT_FAILURE;
+        ft_fprintf(stderr, "%s", err->buff);
+        ft_dstrclr(err);
+    } else if (ofile->splits != NULL) split_output(ofile);
+
+    return EXIT_FAILURE;
+}
+
+int
+write_all (int fd, const char *buff, size_t size) {
+
+    /* Output goes out in as few writes as the system allows, rather than through stdio. */
+    while (size > 0) {
+
+        const ssize_t written = write(fd, buff, size);
+
+        if (written == -1 && errno == EINTR) continue;
+        if (written <= 0) return EXIT_FAILURE;
+
+        buff += written;
+        size -= (size_t)written;
     }
 
-    ft_fprintf(stderr, "%s: \'%s\': %s %s ", meta->bin, meta->path, errors[0], filecodes[meta->type]);
-    switch (meta->errcode) {
-        case E_INV4L:
-            ft_fprintf(stderr, "(load command %u %s %d)\n", meta->k_command, errors[meta->errcode], meta->arch ? 8 : 4);
-            break;
-        case E_ARFMAG:
-            ft_fprintf(stderr, "(%s %s values for the archive member header for %s)\n", errors[meta->errcode],
-                    STR(ARFMAG), meta->ar_member);
-            break;
-        case E_AROFFSET:
-            ft_fprintf(stderr, "(%s %s)\n", errors[meta->errcode], meta->ar_member);
-            break;
-        case E_AROVERLAP:
-            ft_fprintf(stderr, "(%s)\n", errors[meta->errcode]);
-            break;
-        case E_LOADOFF:
-            ft_fprintf(stderr, "(load command %u %s)\n", meta->k_command + 1, errors[meta->errcode]);
-            break;
-        case E_SEGOFF:
-            ft_fprintf(stderr, "(load command %u %s in %s %s", meta->k_command, errors[meta->errcode],
-                    segcodes[meta->command], ERR_XTEND);
-            break;
-        case E_FATOFF:
-            ft_fprintf(stderr, "(%s cputype (%d) cpusubtype (%d) %s", errors[meta->errcode], meta->u_n.n_cpu,
-                    meta->u_k.k_cpu, ERR_XTEND);
-            break;
-        case E_SYMSTRX:
-        default:
-            ft_fprintf(stderr, "(%s: %d past the end of string table, for symbol at index %u)\n",
-                    errors[meta->errcode], meta->u_n.n_strindex, meta->u_k.k_strindex);
+    return EXIT_SUCCESS;
+}
+
+static void
+push_bytes (t_dstr *dstr, const char *bytes, size_t size) {
+
+    /* Output is appended as it is, rather than formatted, with the NUL the buffer's readers expect kept after it. */
+    if (dstr->len + size + 1 > dstr->cap) {
+
+        size_t  cap = dstr->cap ? dstr->cap : 64;
+        char    *buff;
+
+        while (cap < dstr->len + size + 1) cap *= 2;
+        if ((buff = realloc(dstr->buff, cap)) == NULL) return;
+
+        dstr->buff = buff;
+        dstr->cap = cap;
     }
 
-    /* Because nm is so fancy, it prints an addional newline for some reason. */
-    if (meta->obin == FT_NM) ft_fprintf(stderr, "\n");
-    
-    return EXIT_FAILURE;
+    ft_memcpy(dstr->buff + dstr->len, bytes, size);
+    dstr->len += size;
+    dstr->buff[dstr->len] = '\0';
+}
+
+static void
+flush_object (t_ofile *ofile) {
+
+    /* Output object and clear buffer, or keep it for later if we are running jobs. */
+    if (ofile->buffer->buff == NULL) return;
+    if (ofile->output == NULL) write_all(STDOUT_FILENO, ofile->buffer->buff, ofile->buffer->len);
+    else push_bytes(ofile->output, ofile->buffer->buff, ofile->buffer->len);
+
+    ft_dstrclr(ofile->buffer);
+    ofile->pending = 0;
+    ofile->flushes++;
+}
+
+void
+push_output (t_ofile *ofile, const char *block, size_t size) {
+
+    /*
+       Dumpers push their output here once the object has been checked. When it's printed rather than captured, it's
+       written out whenever the buffer grows past its bound, so the buffer doesn't grow with the object. Nothing of an
+       object is written before it's been checked, so an object that fails still prints nothing but its error. With
+       --dedup the bound stays the same: a body that outgrows it is written out and isn't kept for the copies.
+    */
+
+    push_bytes(ofile->buffer, block, size);
+    ofile->pending += size;
+    if (ofile->output == NULL && ofile->pending >= OUTPUT_BOUND) flush_object(ofile);
 }
 
 static void
@@ -116,40 +262,18 @@ header_dump (t_ofile *ofile, t_object *object) {
             (caps ? 128 : 0), filetype, ncmds, sizeofcmds, flags);
 }
 
-static int
-read_macho_file (t_ofile *ofile, t_object *object, t_meta *meta) {
-
-    struct mach_header *header = (struct mach_header *)opeek(object, 0, sizeof *header);
-    if (header == NULL) return (meta->errcode = E_GARBAGE), EXIT_FAILURE;
-
-    uint32_t ncmds = oswap_32(object, header->ncmds);
-    size_t offset = header_size[object->is_64];
-
-    /* If the object isn't an archive or fat, retrieve the architecture. */
-    if (object->nxArchInfo == NULL) object->nxArchInfo = NXGetArchInfoFromCpuType((cpu_type_t)oswap_32(object,
-            (uint32_t)header->cputype), (cpu_subtype_t)oswap_32(object, (uint32_t)header->cpusubtype));
-
-    /* Output (or not) the name of the file or of the archive / fat. */
-    if (meta->obin == FT_NM || ofile->opt & OTOOL_d || ofile->opt & OTOOL_t) {
-
-        if (meta->obin == FT_NM && (ofile->opt & NAME_OUTPUT || ofile->opt & ARCH_OUTPUT || meta->type == E_AR))
-            ft_dstrfpush(ofile->buffer, "\n");
-
-        if (meta->type == E_AR) {
+OFILE_INLINE int
+read_commands (t_ofile *ofile, t_object *object, t_meta *meta, const bool is_64, const bool is_cigam) {
 
-            ft_dstrfpush(ofile->buffer, "%s(%s):\n", meta->path, object->name);
-        } else {
-
-            /* Weird conditions to match the outputs of both nm and otool. */
-            if (ofile->opt & NAME_OUTPUT || ofile->opt & ARCH_OUTPUT) ft_dstrfpush(ofile->buffer, "%s", object->name);
-            if (ofile->opt & ARCH_OUTPUT) ft_dstrfpush(ofile->buffer, " (%sarchitecture %s)",
-                    (meta->obin == FT_NM) ? "for " : "", ofile->arch);
-            if (ofile->opt & NAME_OUTPUT || ofile->opt & ARCH_OUTPUT) ft_dstrfpush(ofile->buffer, ":\n");
-        }
-    }
+    const struct mach_header    *header = (struct mach_header *)object->object;
+    const uint32_t              ncmds = cswap_32(is_cigam, header->ncmds);
+    const int                   variant = OFILE_VARIANT(is_64, is_cigam);
+    size_t                      offset = header_size[is_64];
 
     /* Initialize our section iterator for nm. Starts at 1 as we take into account LC_SYMTAB. */
     object->k_sect = 1;
+    object->dysymtab = NULL;
+    object->base = 0;
 
     /*
        Let's go though the commands. We will save the LC_SYMTAB for later as we first need to save the section numbers
@@ -157,19 +281,21 @@ read_macho_file (t_ofile *ofile, t_object *object, t_meta *meta) {
     */
 
     size_t symtab_offset = 0;
+    size_t exports_offset = 0;
+    bool exports_short = false;
     for (meta->k_command = 0; meta->k_command < ncmds; meta->k_command++) {
 
         const struct load_command *loader = (struct load_command *)opeek(object, offset, sizeof *loader);
         if (loader == NULL) return (meta->errcode = E_GARBAGE), EXIT_FAILURE;
 
-        meta->command = oswap_32(object, loader->cmd);
-        const uint32_t cmdsize = oswap_32(object, loader->cmdsize);
+        meta->command = cswap_32(is_cigam, loader->cmd);
+        const uint32_t cmdsize = cswap_32(is_cigam, loader->cmdsize);
 
         /* Various command loader checks. */
         if (offset + cmdsize > object->size) return (meta->errcode = E_LOADOFF), EXIT_FAILURE;
-        if (cmdsize % (object->is_64 ? 8 : 4)) {
+        if (cmdsize % (is_64 ? 8 : 4)) {
 
-            meta->arch = object->is_64;
+            meta->arch = is_64;
             meta->errcode = E_INV4L;
             return EXIT_FAILURE;
         }
@@ -180,33 +306,185 @@ read_macho_file (t_ofile *ofile, t_object *object, t_meta *meta) {
             return EXIT_FAILURE;
         }
 
-        /* Save the offset of LC_SYMTAB to use it later. */
+        /*
+           Save the offset of LC_SYMTAB to use it later, and LC_DYSYMTAB for nm to know where each kind of symbol is. The
+           export trie is read from the last dyld command, which must hold the fields that locate it.
+        */
+
         if (meta->command == LC_SYMTAB) symtab_offset = offset;
+        else if (meta->command == LC_DYSYMTAB && cmdsize >= sizeof(struct dysymtab_command))
+            object->dysymtab = (struct dysymtab_command *)(object->object + offset);
+        else if (meta->command == LC_DYLD_INFO || meta->command == LC_DYLD_INFO_ONLY
+            || meta->command == LC_DYLD_EXPORTS_TRIE) {
+
+            exports_offset = offset;
+            exports_short = cmdsize < (meta->command == LC_DYLD_EXPORTS_TRIE
+                    ? sizeof(struct linkedit_data_command) : sizeof(struct dyld_info_command));
+        }
 
         /* We run through the segments (and only the segments) first. */
-        else if (meta->command <= LC_SEGMENT_64 && meta->reader[meta->command]
-        && meta->reader[meta->command](ofile, object, meta, offset) != EXIT_SUCCESS) return EXIT_FAILURE;
+        else if (meta->command <= LC_SEGMENT_64 && meta->reader[meta->command][variant]
+        && meta->reader[meta->command][variant](ofile, object, meta, offset) != EXIT_SUCCESS) return EXIT_FAILURE;
 
-        offset += oswap_32(object, loader->cmdsize);
+        offset += cswap_32(is_cigam, loader->cmdsize);
     }
 
     /* Go through LC_SYMTAB. For otool, and only if -t or -d is specified, this will prevent dumping a corrupted file. */
-    if (symtab_offset && (meta->obin == FT_NM || ofile->opt & OTOOL_d || ofile->opt & OTOOL_t)
-    && meta->reader[LC_SYMTAB](ofile, object, meta, symtab_offset) != EXIT_SUCCESS) return EXIT_FAILURE;
+    if (meta->obin == FT_NM && ofile->opt & NM_EXPORTS) {
+
+        /* nm --exports reads the export trie instead, its reader sits with the other ones under LC_DYLD_INFO. */
+        if (exports_short) return (meta->errcode = E_TRIE), EXIT_FAILURE;
+        if (exports_offset && meta->reader[LC_DYLD_INFO][variant](ofile, object, meta, exports_offset) != EXIT_SUCCESS)
+            return EXIT_FAILURE;
+    } else if (symtab_offset && (meta->obin == FT_NM || ofile->opt & OTOOL_d || ofile->opt & OTOOL_t)
+    && meta->reader[LC_SYMTAB][variant](ofile, object, meta, symtab_offset) != EXIT_SUCCESS) return EXIT_FAILURE;
+
+    /* Every command has been checked, go through them again for the dumpers, which can then stream their output. */
+    offset = header_size[is_64];
+    for (uint32_t k = 0; meta->dumper != NULL && k < ncmds; k++) {
+
+        const struct load_command *loader = (struct load_command *)(object->object + offset);
+        const uint32_t command = cswap_32(is_cigam, loader->cmd);
+
+        if (command <= LC_SEGMENT_64 && meta->dumper[command][variant]
+        && meta->dumper[command][variant](ofile, object, meta, offset) != EXIT_SUCCESS) return EXIT_FAILURE;
+
+        offset += cswap_32(is_cigam, loader->cmdsize);
+    }
 
     if (ofile->opt & OTOOL_h) header_dump(ofile, object);
+    return EXIT_SUCCESS;
+}
+
+OFILE_INLINE int
+read_macho_file (t_ofile *ofile, t_object *object, t_meta *meta, const bool is_64, const bool is_cigam) {
+
+    struct mach_header *header = (struct mach_header *)opeek(object, 0, sizeof *header);
+    if (header == NULL) return (meta->errcode = E_GARBAGE), EXIT_FAILURE;
+
+    /* If the object isn't an archive or fat, retrieve the architecture. */
+    if (object->nxArchInfo == NULL) object->nxArchInfo = NXGetArchInfoFromCpuType((cpu_type_t)cswap_32(is_cigam,
+            (uint32_t)header->cputype), (cpu_subtype_t)cswap_32(is_cigam, (uint32_t)header->cpusubtype));
+
+    /* Output (or not) the name of the file or of the archive / fat. */
+    if (meta->obin == FT_NM || ofile->opt & OTOOL_d || ofile->opt & OTOOL_t) {
+
+        if (meta->obin == FT_NM && (ofile->opt & NAME_OUTPUT || ofile->opt & ARCH_OUTPUT || meta->type == E_AR))
+            ft_dstrfpush(ofile->buffer, "\n");
+
+        if (meta->type == E_AR) {
+
+            ft_dstrfpush(ofile->buffer, "%s(%s):\n", meta->path, object->name);
+        } else {
+
+            /* Weird conditions to match the outputs of both nm and otool. */
+            if (ofile->opt & NAME_OUTPUT || ofile->opt & ARCH_OUTPUT) ft_dstrfpush(ofile->buffer, "%s", object->name);
+            if (ofile->opt & ARCH_OUTPUT) ft_dstrfpush(ofile->buffer, " (%sarchitecture %s)",
+                    (meta->obin == FT_NM) ? "for " : "", ofile->arch);
+            if (ofile->opt & NAME_OUTPUT || ofile->opt & ARCH_OUTPUT) ft_dstrfpush(ofile->buffer, ":\n");
+        }
+    }
+
+    /*
+       With --dedup, an object with the same bytes as one printed before gets the same body under its own header.
+       otool's dumps also depend on the architecture the object was found under.
+    */
+
+    const size_t    body = ofile->buffer->len;
+    const size_t    flushes = ofile->flushes;
+    const char      *kept = NULL;
+    size_t          length = 0;
+    uint64_t        digest[2];
+    int             found = DEDUP_MISS;
+
+    if (ofile->dedup != NULL) {
+
+        dedup_digest(object->object, object->size, (meta->obin == FT_OTOOL && object->nxArchInfo != NULL)
+                ? (uint64_t)(uint32_t)object->nxArchInfo->cputype : 0, digest);
+        found = dedup_find(ofile->dedup, digest, object->object, object->size, &kept, &length);
+    }
+
+    const int retcode = (found == DEDUP_FOUND) ? (push_output(ofile, kept, length), EXIT_SUCCESS)
+            : read_commands(ofile, object, meta, is_64, is_cigam);
+
+    /* The body is kept unless the object failed, or part of it was written out already. */
+    if (found == DEDUP_CLAIMED) {
+
+        const bool  whole = retcode == EXIT_SUCCESS && ofile->flushes == flushes;
+        const char  *output = ofile->buffer->buff != NULL ? ofile->buffer->buff : "";
+
+        dedup_keep(ofile->dedup, digest, object->object, object->size, whole ? output + body : NULL,
+                whole ? ofile->buffer->len - body : 0);
+    }
+
+    if (retcode != EXIT_SUCCESS) return EXIT_FAILURE;
 
     /* In some cases NXArchInfo will be malloc (arch (3)), free it to prevent leaks. */
     NXFreeArchInfo(object->nxArchInfo);
 
-    /* Output object and clear buffer. */
-    ft_fprintf(stdout, ofile->buffer->buff);
+    flush_object(ofile);
+    return EXIT_SUCCESS;
+}
+
+OFILE_SPECIALIZE(read_macho_file, (t_ofile *ofile, t_object *object, t_meta *meta), (ofile, object, meta))
+
+static void
+dump_unit (void *ctx, size_t k) {
+
+    t_units *units = ctx;
+    t_unit  *unit = &units->units[k];
+    t_ofile ofile = units->base;
+    t_arena arena = {0};
+
+    /*
+       When dumping in parallel, each unit gets its own buffers, which are joined in order, and its own arena. Anything
+       nested in it (an archive in a fat slice) is processed serially.
+    */
+
+    if (unit->arch != NULL) ofile.arch = unit->arch;
+    if (units->deferred) {
+
+        ofile.buffer = &unit->job.buffer;
+        ofile.output = &unit->job.output;
+        ofile.errors = &unit->job.errors;
+        ofile.splits = NULL;
+        ofile.arena = &arena;
+        ofile.jobs = 1;
+    }
+
+    unit->job.retcode = dispatch(&ofile, &unit->object, &unit->meta);
+    arena_del(&arena);
+}
+
+static int
+emit_unit (void *ctx, size_t k) {
+
+    t_units *units = ctx;
+    t_unit  *unit = &units->units[k];
+    t_ofile *ofile = units->ofile;
+
+    if (unit->job.output.buff != NULL) {
+
+        push_bytes(ofile->buffer, unit->job.output.buff, unit->job.output.len);
+        flush_object(ofile);
+    }
+
+    clear_job(&unit->job);
+    if (unit->job.retcode == EXIT_SUCCESS) return EXIT_SUCCESS;
+
+    if (units->keep_going == false) {
+
+        *units->meta = unit->meta;
+        return EXIT_FAILURE;
+    }
+
+    printerr(ofile, &unit->meta);
     ft_dstrclr(ofile->buffer);
     return EXIT_SUCCESS;
 }
 
 static int
-process_archive (t_ofile *ofile, t_object *object, t_meta *meta, size_t *offset) {
+process_archive (const t_object *object, t_unit *member, t_meta *meta, size_t *offset) {
 
     int retcode = EXIT_SUCCESS;
     const struct ar_hdr *ar_hdr = (struct ar_hdr *)opeek(object, *offset, sizeof *ar_hdr);
@@ -222,67 +500,336 @@ process_archive (t_ofile *ofile, t_object *object, t_meta *meta, size_t *offset)
     const int size = ft_atoi(ar_hdr->ar_size);
     if (size < 0) return EXIT_FAILURE; /* E_RRNO */
 
-    /* Populate our object. */
+    /* Populate our member, it starts off as a copy of the archive object. */
     *offset += sizeof *ar_hdr;
-    object->size = (size_t)size;
+    member->object = *object;
+    member->object.size = (size_t)size;
     int name_size = 0;
     if (ft_strnequ(ar_hdr->ar_name, AR_EFMT1, SAR_EFMT1)) {
 
         name_size = ft_atoi(ar_hdr->ar_name + SAR_EFMT1);
         if (name_size < 0) return EXIT_FAILURE; /* E_RRNO */
 
-        object->object = ofile->file + *offset + name_size;
-        object->name = ofile->file + *offset;
+        member->object.object = object->object + *offset + name_size;
+        member->object.name = object->object + *offset;
     } else {
 
-        object->object = ofile->file + *offset;
-        object->name = ar_hdr->ar_name;
+        member->object.object = object->object + *offset;
+        member->object.name = ar_hdr->ar_name;
     }
 
     /* Adujst size if name is EFMT1 */
-    if (*offset + object->size > ofile->size) {
+    if (*offset + member->object.size > object->size) {
 
         meta->errcode = E_AROFFSET;
         retcode = EXIT_FAILURE;
     }
 
-    *offset += object->size;
-    object->size -= (size_t)name_size;
-    meta->ar_member = ft_strdup(object->name);
+    *offset += member->object.size;
+    member->object.size -= (size_t)name_size;
+    meta->ar_member = member->object.name;
     return retcode;
 }
 
+static t_unit *
+new_member (t_units *members, size_t nmembers, size_t *capacity) {
+
+    if (nmembers == *capacity) {
+
+        *capacity = *capacity ? *capacity * 2 : 64;
+        t_unit *units = arena_grow(members->ofile->arena, members->units, nmembers * sizeof *units,
+                *capacity * sizeof *units);
+        if (units == NULL) return NULL;
+        members->units = units;
+    }
+
+    return &members->units[nmembers];
+}
+
+typedef struct          s_ranlib {
+    const t_object      *symdef;
+    size_t              word;
+    size_t              entsize;
+    size_t              nranlibs;
+    size_t              stroff;
+    uint64_t            strsize;
+    bool                is_64;
+}                       t_ranlib;
+
+static uint64_t
+ranlib_word (const t_ranlib *ranlib, const size_t offset) {
+
+    const t_object *symdef = ranlib->symdef;
+
+    return ranlib->is_64
+            ? oswap_64(symdef, *(uint64_t *)(symdef->object + offset))
+            : oswap_32(symdef, *(uint32_t *)(symdef->object + offset));
+}
+
+static int
+ranlib_cmp (const t_ranlib *ranlib, const size_t k, const char *symbol) {
+
+    /* The string table may not be NUL terminated, so don't compare past its end. */
+    const uint64_t ran_strx = ranlib_word(ranlib, ranlib->word + k * ranlib->entsize);
+    if (ran_strx >= ranlib->strsize) return 1;
+
+    return ft_strncmp(ranlib->symdef->object + ranlib->stroff + ran_strx, symbol,
+            (size_t)(ranlib->strsize - ran_strx));
+}
+
+static bool
+ranlib_init (t_ranlib *ranlib) {
+
+    /*
+       The SYMDEF member holds the size of the ranlib array, the array itself, the size of the string table and the
+       string table.
+    */
+
+    const t_object *object = ranlib->symdef;
+    if (opeek(object, 0, ranlib->word) == NULL) return false;
+
+    const uint64_t ransize = ranlib_word(ranlib, 0);
+    if (ransize % ranlib->entsize || ransize > object->size) return false;
+    if (opeek(object, ranlib->word + ransize, ranlib->word) == NULL) return false;
+
+    ranlib->nranlibs = ransize / ranlib->entsize;
+    ranlib->stroff = 2 * ranlib->word + ransize;
+    ranlib->strsize = ranlib_word(ranlib, ranlib->word + ransize);
+
+    return ranlib->strsize <= object->size && opeek(object, ranlib->stroff, ranlib->strsize) != NULL;
+}
+
+static size_t
+lookup_ranlib (t_arena *arena, t_object *symdef, const char *symbol, const bool is_64, const bool sorted,
+        uint64_t **found) {
+
+    /* Returns the number of member offsets found, or SIZE_MAX if the table isn't usable or they can't be kept. */
+    t_ranlib ranlib = {
+            .symdef = symdef,
+            .word = is_64 ? sizeof(uint64_t) : sizeof(uint32_t),
+            .entsize = is_64 ? sizeof(struct ranlib_64) : sizeof(struct ranlib),
+            .is_64 = is_64
+    };
+
+    /* The table is in the byte order of the host that built the archive, so we try both. */
+    symdef->is_cigam = false;
+    if (ranlib_init(&ranlib) == false && (symdef->is_cigam = true) && ranlib_init(&ranlib) == false) return SIZE_MAX;
+
+    /* Sorted tables can be binary searched for the first match, otherwise we have to look at every entry. */
+    size_t first = 0;
+    if (sorted) {
+
+        size_t last = ranlib.nranlibs;
+        while (first < last) {
+
+            const size_t mid = first + (last - first) / 2;
+            if (ranlib_cmp(&ranlib, mid, symbol) < 0) first = mid + 1;
+            else last = mid;
+        }
+    }
+
+    uint64_t *offsets = NULL;
+    size_t noffsets = 0, capacity = 0;
+    for (size_t k = first; k < ranlib.nranlibs; k++) {
+
+        if (ranlib_cmp(&ranlib, k, symbol) != 0) {
+
+            if (sorted) break;
+            continue;
+        }
+
+        if (noffsets == capacity) {
+
+            const size_t grown = capacity ? capacity * 2 : SYMDEF_OFFSETS;
+
+            offsets = arena_grow(arena, offsets, capacity * sizeof *offsets, grown * sizeof *offsets);
+            if (offsets == NULL) return SIZE_MAX; /* E_RRNO */
+            capacity = grown;
+        }
+
+        offsets[noffsets++] = ranlib_word(&ranlib, ranlib.word + k * ranlib.entsize + ranlib.word);
+    }
+
+    /* Members are printed in archive order, and once even if they define the symbol more than once. */
+    for (size_t k = 1; k < noffsets; k++) {
+
+        for (size_t j = k; j > 0 && offsets[j - 1] > offsets[j]; j--) {
+
+            const uint64_t tmp = offsets[j];
+            offsets[j] = offsets[j - 1];
+            offsets[j - 1] = tmp;
+        }
+    }
+
+    size_t nunique = 0;
+    for (size_t k = 0; k < noffsets; k++) if (k == 0 || offsets[k] != offsets[k - 1]) offsets[nunique++] = offsets[k];
+
+    *found = offsets;
+    return nunique;
+}
+
+static size_t
+find_defines (const t_ofile *ofile, t_object *symdef, uint64_t **offsets) {
+
+    /* Find the members defining our symbol in the SYMDEF table, by the offsets of their headers. */
+    const char *name = symdef->name;
+    const bool is_64 = ft_strequ(name, SYMDEF_64) || ft_strequ(name, SYMDEF_64_SORTED);
+    const bool sorted = ft_strequ(name, SYMDEF_SORTED) || ft_strequ(name, SYMDEF_64_SORTED);
+
+    return lookup_ranlib(ofile->arena, symdef, ofile->defines, is_64, sorted, offsets);
+}
+
+static int
+index_defines (t_object *object, t_object *symdef, t_meta *meta, t_units *members, size_t *nmembers,
+        size_t *capacity) {
+
+    /* Index only the members defining our symbol. */
+    uint64_t *offsets;
+
+    const size_t noffsets = find_defines(members->ofile, symdef, &offsets);
+    if (noffsets == SIZE_MAX) return EXIT_FAILURE;
+
+    for (size_t k = 0; k < noffsets; k++) {
+
+        t_meta member_meta = *meta;
+        size_t offset = (size_t)offsets[k];
+        t_unit *member = new_member(members, *nmembers, capacity);
+        if (member == NULL || offsets[k] < SARMAG || offsets[k] >= object->size
+        || process_archive(object, member, &member_meta, &offset) != EXIT_SUCCESS) return EXIT_FAILURE;
+
+        member->meta = member_meta;
+        member->job = (t_job){.retcode = EXIT_SUCCESS};
+        member->arch = NULL;
+        *nmembers += 1;
+    }
+
+    return EXIT_SUCCESS;
+}
+
+static int
+stream_archive (t_ofile *ofile, t_object *object, t_meta *meta) {
+
+    /*
+       An archive read from a stream is dumped member by member as it's read, rather than indexed first. Each member
+       comes in a view of its own that starts at its header, which is dropped once the member has been dumped. The view
+       of a member that failed is kept, as the error names the member.
+    */
+
+    t_unit          member;
+    t_units         members = {.ofile = ofile, .meta = meta, .base = *ofile, .units = &member};
+    uint64_t        *defines = NULL;
+    size_t          ndefines = SIZE_MAX, next = 0;
+    uint64_t        offset = SARMAG;
+
+    meta->type = E_AR;
+    for (size_t k = 0; ; k++) {
+
+        struct ar_hdr   header;
+        size_t          size = 0, end = 0;
+
+        const bool      more = stream_read(ofile->stream, offset, &header, sizeof header) != 0;
+        const int       length = ft_atoi(header.ar_size);
+        const void      *view = stream_view(ofile->stream, offset, offset + sizeof header
+                + (length > 0 ? (uint64_t)length : 0), &size);
+
+        if (view == NULL) return (meta->errcode = E_RRNO), EXIT_FAILURE;
+        if (more == false && k > 0) return stream_drop(ofile->stream, view), EXIT_SUCCESS;
+
+        /* Headers past the SYMDEF are only checked while walking the members, not when it says which ones to read. */
+        t_object archive = *object;
+
+        archive.object = view;
+        archive.size = size;
+        if (process_archive(&archive, &member, meta, &end) != EXIT_SUCCESS)
+            return (k > 0 && ndefines != SIZE_MAX) ? EXIT_SUCCESS : EXIT_FAILURE;
+
+        if (k == 0) {
+
+            /* Check SYMDEF validity. */
+            const char *symdef_name = (const char *)view + sizeof(struct ar_hdr);
+            if (ft_strequ(symdef_name, SYMDEF) == 0 && ft_strequ(symdef_name, SYMDEF_SORTED) == 0
+            && ft_strequ(symdef_name, SYMDEF_64) == 0 && ft_strequ(symdef_name, SYMDEF_64_SORTED) == 0)
+                return EXIT_FAILURE; /* E_RRNO */
+
+            if (ofile->defines != NULL) ndefines = find_defines(ofile, &member.object, &defines);
+            if (meta->obin == FT_OTOOL) ft_dstrfpush(ofile->buffer, "Archive : %s\n", meta->path);
+        } else {
+
+            while (ndefines != SIZE_MAX && next < ndefines && defines[next] < offset) next++;
+            if (ndefines == SIZE_MAX || (next < ndefines && defines[next] == offset)) {
+
+                member.meta = *meta;
+                member.job = (t_job){.retcode = EXIT_SUCCESS};
+                member.arch = NULL;
+                dump_unit(&members, 0);
+                if (emit_unit(&members, 0) != EXIT_SUCCESS) return EXIT_FAILURE;
+            }
+        }
+
+        stream_drop(ofile->stream, view);
+        offset += end;
+    }
+}
+
 static int
 read_archive (t_ofile *ofile, t_object *object, t_meta *meta) {
 
-    const void *restore = ofile->file;
-    ofile->file = object->object;
     size_t offset = SARMAG;
+    t_unit symdef;
 
+    /* Only a stream's own archive is read from it, an archive in a fat slice comes whole in the slice's view. */
+    if (ofile->stream != NULL && object->object == ofile->file) return stream_archive(ofile, object, meta);
     if (meta->type != E_FAT) meta->type = E_AR;
-    if (process_archive(ofile, object, meta, &offset) != EXIT_SUCCESS) return EXIT_FAILURE;
+    if (process_archive(object, &symdef, meta, &offset) != EXIT_SUCCESS) return EXIT_FAILURE;
 
     /* Check SYMDEF validity. */
-    const char *symdef = ofile->file + sizeof(struct ar_hdr) + SARMAG;
-    if (ft_strequ(symdef, SYMDEF) == 0 && ft_strequ(symdef, SYMDEF_SORTED) == 0 && ft_strequ(symdef, SYMDEF_64) == 0
-        && ft_strequ(symdef, SYMDEF_64_SORTED) == 0) return EXIT_FAILURE; /* E_RRNO */
+    const char *symdef_name = object->object + sizeof(struct ar_hdr) + SARMAG;
+    if (ft_strequ(symdef_name, SYMDEF) == 0 && ft_strequ(symdef_name, SYMDEF_SORTED) == 0
+    && ft_strequ(symdef_name, SYMDEF_64) == 0 && ft_strequ(symdef_name, SYMDEF_64_SORTED) == 0)
+        return EXIT_FAILURE; /* E_RRNO */
+
+    t_units members = {
+            .ofile = ofile,
+            .meta = meta,
+            .deferred = ofile->jobs > 1
+    };
+    size_t nmembers = 0, capacity = 0;
+    int retcode = EXIT_SUCCESS;
 
-    /* Archive looks valid so far, let's loop through each of it's member. */
+    /* When looking for a symbol, the SYMDEF table tells us which members to read. If it can't, we read them all. */
+    if (ofile->defines != NULL && index_defines(object, &symdef.object, meta, &members, &nmembers,
+    &capacity) != EXIT_SUCCESS)
+        nmembers = 0;
+    else if (ofile->defines != NULL) offset = object->size;
 
-    if (meta->obin == FT_OTOOL) ft_dstrfpush(ofile->buffer, "Archive : %s\n", meta->path);
+    /*
+       Archive looks valid so far. Index its members first, up to the first broken header. The ones before it are then
+       dumped (in parallel if we have jobs to spare), and only then is the error reported.
+    */
+
+    while (offset != object->size) {
 
-    while (offset != ofile->size) {
+        t_unit *member = new_member(&members, nmembers, &capacity);
+        if (member == NULL) return EXIT_FAILURE; /* E_RRNO */
 
-        /* Restore full object. */
-        object->object = ofile->file;
-        object->size = ofile->size;
+        if (process_archive(object, member, meta, &offset) != EXIT_SUCCESS) {
 
-        if (process_archive(ofile, object, meta, &offset) != EXIT_SUCCESS) return EXIT_FAILURE;
-        if (dispatch(ofile, object, meta) != EXIT_SUCCESS) return EXIT_FAILURE;
+            retcode = EXIT_FAILURE;
+            break;
+        }
+
+        member->meta = *meta;
+        member->job = (t_job){.retcode = EXIT_SUCCESS};
+        member->arch = NULL;
+        nmembers += 1;
     }
 
-    ofile->file = restore;
-    return EXIT_SUCCESS;
+    if (meta->obin == FT_OTOOL) ft_dstrfpush(ofile->buffer, "Archive : %s\n", meta->path);
+    members.base = *ofile;
+    if (pool_run(nmembers, ofile->jobs, dump_unit, emit_unit, &members) != EXIT_SUCCESS) retcode = EXIT_FAILURE;
+
+    for (size_t k = 0; k < nmembers; k++) clear_job(&members.units[k].job);
+    return retcode;
 }
 
 static int
@@ -296,7 +843,8 @@ test_offset_fat_arch (t_ofile *ofile, const t_object *object, t_meta *meta, cons
             ? oswap_64(object, ((struct fat_arch_64 *)ptr)->size)
             : oswap_32(object, ((struct fat_arch *)ptr)->size);
 
-    if (offset + size > ofile->size) {
+    /* A stream is only known to be that long once it has been read up to there. */
+    if (offset + size > (ofile->stream != NULL ? stream_reach(ofile->stream, offset + size) : ofile->size)) {
 
         meta->u_n.n_cpu = object->nxArchInfo->cputype;
         meta->u_k.k_cpu = object->nxArchInfo->cpusubtype;
@@ -308,33 +856,35 @@ test_offset_fat_arch (t_ofile *ofile, const t_object *object, t_meta *meta, cons
 }
 
 static int
-dispatch_fat (t_ofile *ofile, t_object *object, t_meta *meta, const void *ptr) {
+fat_slice (const t_ofile *ofile, const t_object *object, const void *ptr, t_object *slice) {
+
+    /*
+       Each architecture is treated as an independent Mach-O file with its own object. Endianness and 64 will be
+       overriden by dispatch as the object will be treated anew. A stream's slice is read up to its end into a view.
+    */
+
+    uint64_t offset, size;
 
+    *slice = *object;
     if (object->is_64 == false) {
 
         const struct fat_arch *arch = (struct fat_arch *)ptr;
-        object->object = ofile->file + oswap_32(object, arch->offset);
-        object->size = oswap_32(object, arch->size);
+        offset = oswap_32(object, arch->offset);
+        size = oswap_32(object, arch->size);
     } else {
 
         const struct fat_arch_64 *arch_64 = (struct fat_arch_64 *)ptr;
-        object->object = ofile->file + oswap_64(object, arch_64->offset);
-        object->size = oswap_64(object, arch_64->size);
+        offset = oswap_64(object, arch_64->offset);
+        size = oswap_64(object, arch_64->size);
     }
 
-    /*
-       Endianness and 64 will be overriden by dispatch as the object will be treated anew, we save them to restore
-       them after the object has been processed.
-    */
-
-    const bool fat_is_64 = object->is_64;
-    const bool fat_is_cigam = object->is_cigam;
-    const int retcode = dispatch(ofile, object, meta);
-    object->is_64 = fat_is_64;
-    object->is_cigam = fat_is_cigam;
-    object->object = ofile->file;
+    if (ofile->stream != NULL)
+        return (slice->object = stream_view(ofile->stream, offset, offset + size, &slice->size)) != NULL
+                ? EXIT_SUCCESS : EXIT_FAILURE; /* E_RRNO */
 
-    return retcode;
+    slice->object = ofile->file + offset;
+    slice->size = (size_t)size;
+    return EXIT_SUCCESS;
 }
 
 static int
@@ -344,8 +894,9 @@ read_fat_file (t_ofile *ofile, t_object *object, t_meta *meta) {
     struct fat_header *fat_header = (struct fat_header *)opeek(object, 0, sizeof *fat_header);
     if (fat_header == NULL) return (meta->errcode = E_GARBAGE), EXIT_FAILURE;
 
+    const size_t stride = object->is_64 ? sizeof(struct fat_arch_64) : sizeof(struct fat_arch);
     size_t offset = sizeof *fat_header;
-    const uint32_t nfat_arch = oswap_32(object, fat_header->nfat_arch);
+    uint32_t nfat_arch = oswap_32(object, fat_header->nfat_arch);
 
     /*
        If the "all" architecture flag hasn't been specified, we first iterate through every available architecture in
@@ -358,7 +909,7 @@ read_fat_file (t_ofile *ofile, t_object *object, t_meta *meta) {
 
         for (uint32_t k = 0; k < nfat_arch; k++) {
 
-            const struct fat_arch *fat_arch = (struct fat_arch *)opeek(object, offset, sizeof *fat_arch);
+            const struct fat_arch *fat_arch = (struct fat_arch *)opeek(object, offset, stride);
             if (fat_arch == NULL) return (meta->errcode = E_GARBAGE), EXIT_FAILURE;
 
             object->nxArchInfo = NXGetArchInfoFromCpuType((cpu_type_t)oswap_32(object, (uint32_t)fat_arch->cputype),
@@ -366,15 +917,23 @@ read_fat_file (t_ofile *ofile, t_object *object, t_meta *meta) {
 
             if (object->nxArchInfo == NULL) return (meta->errcode = E_AROVERLAP), EXIT_FAILURE;
             if (test_offset_fat_arch(ofile, object, meta, fat_arch) != EXIT_SUCCESS) return EXIT_FAILURE;
-            if (ft_strequ(ofile->arch, object->nxArchInfo->name)) return dispatch_fat(ofile, object, meta, fat_arch);
+            if (ft_strequ(ofile->arch, object->nxArchInfo->name)) {
+
+                t_object slice;
+                if (fat_slice(ofile, object, fat_arch, &slice) != EXIT_SUCCESS)
+                    return (meta->errcode = E_RRNO), EXIT_FAILURE;
+                return dispatch(ofile, &slice, meta);
+            }
 
-            offset += object->is_64 ? sizeof(struct fat_arch_64) : sizeof(struct fat_arch);
+            offset += stride;
         }
 
         /* The architecture hasn't been found. If no specific arch was mentioned, dump everything. */
         if (no_specific == false) {
 
-            ft_printf("%s: file: %s does not contain architecture: %s.\n", meta->bin, meta->path, ofile->arch);
+            ft_dstrfpush(ofile->buffer, "%s: file: %s does not contain architecture: %s.\n", meta->bin, meta->path,
+                    ofile->arch);
+            flush_object(ofile);
             return EXIT_SUCCESS;
         }
 
@@ -383,60 +942,119 @@ read_fat_file (t_ofile *ofile, t_object *object, t_meta *meta) {
 
     /*
        If this code is reached, either "all" was specified, or the host architecture wasn't found in the fat file.
-       Either way, we can dump everything.
+       Either way, we can dump everything. First validate every architecture, the ones before the first invalid one
+       are then dumped (in parallel if we have jobs to spare), and only then is the error reported.
     */
 
+    if (nfat_arch > (object->size - offset) / stride + 1) nfat_arch = (uint32_t)((object->size - offset) / stride + 1);
+
+    /* In case of an error, nm displays the error but keeps dumping. otool terminates immediately. */
+    t_units slices = {
+            .ofile = ofile,
+            .meta = meta,
+            .units = arena_alloc(ofile->arena, (nfat_arch ? nfat_arch : 1) * sizeof(t_unit)),
+            .deferred = ofile->jobs > 1 && ofile->stream == NULL,
+            .keep_going = meta->obin == FT_NM
+    };
+    if (slices.units == NULL) return EXIT_FAILURE; /* E_RRNO */
+
     ofile->opt |= ARCH_OUTPUT;
-    for (uint32_t k = 0; k < oswap_32(object, fat_header->nfat_arch); k++) {
+    slices.base = *ofile;
+
+    int retcode = EXIT_SUCCESS;
+    uint32_t nslices = 0;
+    for ( ; nslices < nfat_arch; nslices++) {
+
+        const struct fat_arch *fat_arch = (struct fat_arch *)opeek(object, offset, stride);
+        if (fat_arch == NULL) {
 
-        /* Mutate object architecture specifications to treat it as an independent Mach-O file. */
-        const struct fat_arch *fat_arch = (struct fat_arch *)opeek(object, offset, sizeof *fat_arch);
-        if (fat_arch == NULL) return (meta->errcode = E_GARBAGE), EXIT_FAILURE;
+            meta->errcode = E_GARBAGE;
+            retcode = EXIT_FAILURE;
+            break;
+        }
 
         object->nxArchInfo = NXGetArchInfoFromCpuType((cpu_type_t)oswap_32(object, (uint32_t)fat_arch->cputype),
                 (cpu_subtype_t)oswap_32(object, (uint32_t)fat_arch->cpusubtype));
 
-        if (object->nxArchInfo == NULL) return (meta->errcode = E_AROVERLAP), EXIT_FAILURE;
-        if (test_offset_fat_arch(ofile, object, meta, fat_arch) != EXIT_SUCCESS) return EXIT_FAILURE;
+        if (object->nxArchInfo == NULL) meta->errcode = E_AROVERLAP;
+        if (object->nxArchInfo == NULL || test_offset_fat_arch(ofile, object, meta, fat_arch) != EXIT_SUCCESS) {
+
+            retcode = EXIT_FAILURE;
+            break;
+        }
+
+        slices.units[nslices] = (t_unit){
+                .meta = *meta,
+                .arch = object->nxArchInfo->name
+        };
+        if (fat_slice(ofile, object, fat_arch, &slices.units[nslices].object) != EXIT_SUCCESS) {
 
-        ofile->arch = object->nxArchInfo->name;
+            meta->errcode = E_RRNO;
+            retcode = EXIT_FAILURE;
+            break;
+        }
+
+        offset += stride;
 
-        /* In case of an error, nm displays the error but keeps dumping. otool terminates immediately. */
-        if (dispatch_fat(ofile, object, meta, fat_arch) != EXIT_SUCCESS) {
+        /* A stream's slices are dumped as soon as they have been read, and dropped before the next one is read. */
+        if (ofile->stream != NULL) {
 
-            if (meta->obin == FT_OTOOL) return EXIT_FAILURE;
+            dump_unit(&slices, nslices);
+            if (emit_unit(&slices, nslices) != EXIT_SUCCESS) {
 
-            printerr(meta);
-            ft_dstrclr(ofile->buffer);
+                retcode = EXIT_FAILURE;
+                break;
+            }
+
+            stream_drop(ofile->stream, slices.units[nslices].object.object);
         }
+    }
+
+    if (ofile->stream == NULL && pool_run(nslices, ofile->jobs, dump_unit, emit_unit, &slices) != EXIT_SUCCESS)
+        retcode = EXIT_FAILURE;
+
+    for (uint32_t k = 0; k < nslices; k++) clear_job(&slices.units[k].job);
+    return retcode;
+}
+
+static const struct     s_magic {
+    const char          *arch_magic;
+    uint32_t            magic;
+    bool                is_64;
+    bool                is_cigam;
+    int                 (*read_file)(t_ofile *, t_object *, t_meta *);
+}                       magic[] = {
+        {0, MH_MAGIC, false, false, read_macho_file_n32},
+        {0, MH_CIGAM, false, true, read_macho_file_s32},
+        {0, MH_MAGIC_64, true, false, read_macho_file_n64},
+        {0, MH_CIGAM_64, true, true, read_macho_file_s64},
+        {"!<arch>\n", 0, 0, 0, read_archive},
+        {0, FAT_MAGIC, false, false, read_fat_file},
+        {0, FAT_CIGAM, false, true, read_fat_file},
+        {0, FAT_MAGIC_64, true, false, read_fat_file},
+        {0, FAT_CIGAM_64, true, true, read_fat_file},
+};
 
-        offset += sizeof *fat_arch;
+bool
+is_object (const char *head, size_t size) {
+
+    uint32_t value = 0;
+
+    /* Whether dispatch() would find a reader for a file starting with these bytes. */
+    if (size >= sizeof value) ft_memcpy(&value, head, sizeof value);
+    for (size_t k = 0; k < sizeof magic / sizeof *magic; k++) {
+
+        if (magic[k].arch_magic != NULL && size >= SARMAG && ft_strnequ(magic[k].arch_magic, head, SARMAG))
+            return true;
+        if (magic[k].arch_magic == NULL && size >= sizeof value && value == magic[k].magic) return true;
     }
 
-    return EXIT_SUCCESS;
+    return false;
 }
 
 static int
 dispatch (t_ofile *ofile, t_object *object, t_meta *meta) {
 
-    struct s_magic {
-        const char    *arch_magic;
-        uint32_t     magic;
-        bool        is_64;
-        bool        is_cigam;
-        int         (*read_file)(t_ofile *, t_object *, t_meta *);
-    } magic[] = {
-            {0, MH_MAGIC, false, false, read_macho_file},
-            {0, MH_CIGAM, false, true, read_macho_file},
-            {0, MH_MAGIC_64, true, false, read_macho_file},
-            {0, MH_CIGAM_64, true, true, read_macho_file},
-            {"!<arch>\n", 0, 0, 0, read_archive},
-            {0, FAT_MAGIC, false, false, read_fat_file},
-            {0, FAT_CIGAM, false, true, read_fat_file},
-            {0, FAT_MAGIC_64, true, false, read_fat_file},
-            {0, FAT_CIGAM_64, true, true, read_fat_file},
-    };
-
     /* We add 2 to the magic_len as we also need to check for archives. */
     const int magic_len = (int)(sizeof magic / sizeof *magic);
 
@@ -449,9 +1067,14 @@ dispatch (t_ofile *ofile, t_object *object, t_meta *meta) {
         if ((magic[k].arch_magic != NULL && ft_strnequ(magic[k].arch_magic, object->object, SARMAG))
         || *(uint32_t *)object->object == magic[k].magic) {
 
+            /* Whatever the reader takes from the arena is given back once the object has been dumped. */
+            const t_mark mark = arena_mark(ofile->arena);
+
             object->is_64 = magic[k].is_64;
             object->is_cigam = magic[k].is_cigam;
-            return magic[k].read_file(ofile, object, meta);
+            const int retcode = magic[k].read_file(ofile, object, meta);
+            arena_release(ofile->arena, mark);
+            return retcode;
         }
     }
 
@@ -463,23 +1086,7 @@ dispatch (t_ofile *ofile, t_object *object, t_meta *meta) {
 int
 open_file (t_ofile *ofile, t_meta *meta) {
 
-    /* Open the file, perform various checks and map it into memory. */
-    const int     fd = open(meta->path, O_RDONLY);
-    struct stat    stat;
-
-    if (fd == -1 || fstat(fd, &stat) == -1) return EXIT_FAILURE;
-
-    ofile->size = (size_t)stat.st_size;
-    if (ofile->size < sizeof(uint32_t)) return (meta->errcode = E_GARBAGE), EXIT_FAILURE;
-    if (stat.st_mode & S_IFDIR) {
-
-        meta->errcode = E_RRNO;
-        errno = EISDIR;
-        return EXIT_FAILURE;
-    }
-
-    ofile->file = mmap(NULL, ofile->size, PROT_READ, MAP_PRIVATE, fd, 0);
-    if (close(fd) == -1 || ofile->file == MAP_FAILED) return EXIT_FAILURE; /* E_RRNO */
+    if (map_file(ofile, meta) == EXIT_FAILURE) return printerr(ofile, meta);
 
     /*
        We duplicate the file and the file size into the object structure as well, it will allow us to process FAT
@@ -492,9 +1099,189 @@ open_file (t_ofile *ofile, t_meta *meta) {
             .size = ofile->size,
     };
 
-    /* Send the file to the generic dispatcher. */
+    /* Send the file to the generic dispatcher. Errors are reported while it's mapped, they can name a member of it. */
     int retcode = dispatch(ofile, &object, meta);
+    if (retcode != EXIT_SUCCESS) printerr(ofile, meta);
+
+    unmap_file(ofile);
+    return retcode;
+}
+
+typedef struct          s_batch {
+    const t_ofile       *ofile;
+    const t_meta        *meta;
+    const char          **paths;
+    t_job               *jobs;
+    t_prefetch          *prefetch;
+    int                 retcode;
+    unsigned            nthreads;
+    bool                deferred;
+    bool                stored;
+}                       t_batch;
+
+static void
+run_job (void *ctx, size_t k) {
+
+    t_batch *batch = ctx;
+    t_job   *job = &batch->jobs[k];
+
+    /* Every file gets its own copy of the options and metadata, as the readers mutate both. */
+    t_ofile ofile = *batch->ofile;
+    t_meta  meta = *batch->meta;
+
+    ofile.jobs = batch->nthreads;
+    ofile.buffer = &job->buffer;
+    ofile.output = batch->deferred ? &job->output : NULL;
+    ofile.errors = &job->errors;
+    ofile.splits = &job->splits;
+    meta.path = batch->paths[k];
+    meta.errcode = E_RRNO;
+    meta.type = E_MACHO;
+
+    /* With a cache, a file that hasn't changed since an earlier run isn't even opened. */
+    t_dstr key = {0};
+
+    if (ofile.cache != NULL && cache_load(&ofile, &meta, &key, &job->output) == EXIT_SUCCESS) {
+
+        job->retcode = EXIT_SUCCESS;
+        free(key.buff);
+        return;
+    }
+
+    /* Each file gets an arena for its parse-time allocations, reused from one object to the next. */
+    t_arena arena = {0};
+
+    ofile.arena = &arena;
+    ofile.file = NULL;
+    if (batch->prefetch != NULL) prefetch_take(batch->prefetch, k, &ofile.file, &ofile.size);
+    job->retcode = open_file(&ofile, &meta);
+    if (job->retcode == EXIT_SUCCESS && ofile.cache != NULL && (job->errors.buff == NULL || *job->errors.buff == '\0'))
+        job->stored = cache_store(&ofile, &meta, &key, job->output.buff) == EXIT_SUCCESS;
+    job->errcode = meta.errcode;
+    arena_del(&arena);
+    free(key.buff);
+}
+
+static int
+emit_job (void *ctx, size_t k) {
+
+    t_batch *batch = ctx;
+    t_job   *job = &batch->jobs[k];
+
+    /* The batch is either printed, or captured into the caller's buffers when it has some. */
+    if (batch->ofile->output != NULL) {
+
+        if (job->output.buff != NULL) push_bytes(batch->ofile->output, job->output.buff, job->output.len);
+        if (job->errors.buff != NULL) push_bytes(batch->ofile->errors, job->errors.buff, job->errors.len);
+    } else {
+
+        const size_t    outsize = job->output.len;
+        const size_t    errsize = job->errors.len;
+        size_t          out = 0, err = 0;
+
+        /* Output and errors are interleaved as they would have been printed by a single job. */
+        for (size_t s = 0; s <= job->splits.count; s++) {
+
+            const size_t outend = (s < job->splits.count) ? job->splits.ends[s * 2] : outsize;
+            const size_t errend = (s < job->splits.count) ? job->splits.ends[s * 2 + 1] : errsize;
+
+            if (outend > out) write_all(STDOUT_FILENO, job->output.buff + out, outend - out);
+            if (errend > err) write_all(STDERR_FILENO, job->errors.buff + err, errend - err);
+            if (outend > out) out = outend;
+            if (errend > err) err = errend;
+        }
+    }
+
+    clear_job(job);
+    if (job->stored) batch->stored = true;
+    if (job->retcode == EXIT_SUCCESS) return EXIT_SUCCESS;
+
+    /* nm doesn't stop if a file is not a valid object, otool stops at the first file it cannot read. */
+    batch->retcode = EXIT_FAILURE;
+    return (batch->meta->obin == FT_OTOOL && job->errcode == E_RRNO) ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+static int
+run_batch (const t_ofile *ofile, const t_meta *meta, const char **paths, size_t npaths, unsigned jobs) {
+
+    /* Objects are deduplicated across the whole batch, slices and members of different files included. */
+    t_ofile base = *ofile;
+
+    if (ofile->opt & DEDUP_OUTPUT && (base.dedup = dedup_new()) == NULL)
+        return ft_fprintf(stderr, "%s: %s\n", meta->bin, strerror(errno)), EXIT_FAILURE;
+
+    t_batch batch = {
+            .ofile = &base,
+            .meta = meta,
+            .paths = paths,
+            .jobs = calloc(npaths, sizeof(t_job)),
+            .retcode = EXIT_SUCCESS,
+            .nthreads = jobs,
+            .deferred = (jobs > 1 && npaths > 1) || ofile->output != NULL || ofile->cache != NULL
+    };
+
+    if (batch.jobs == NULL) {
+
+        dedup_del(base.dedup);
+        return ft_fprintf(stderr, "%s: %s\n", meta->bin, strerror(errno)), EXIT_FAILURE;
+    }
+
+    /*
+       Files are processed by a pool of workers, and printed in order as they complete. With a single job everything
+       runs in order on this thread and objects are printed as soon as they are read. Files hand their fat slices and
+       archive members back to the pool, so that workers done with their own files can take them over. If the options
+       carry output buffers, the whole batch is captured into them instead of being printed. Output is also captured
+       per file when there is a cache to store it into.
+    */
+
+    /*
+       The files that follow the ones being read are mapped and read ahead in the background. Not when serving, where
+       mappings are kept from one request to the next, nor with a cache, which could spare opening them at all, nor
+       when probing, which reads only a few pages of each.
+    */
+
+    if (npaths > 1 && ofile->prefetch > 0 && ofile->maps == NULL && ofile->cache == NULL
+        && (ofile->opt & OTOOL_PROBE) == 0)
+        batch.prefetch = prefetch_start(paths, npaths, ofile->prefetch,
+                meta->obin == FT_NM && (ofile->opt & NM_EXPORTS) == 0);
+
+    pool_run(npaths, jobs, run_job, emit_job, &batch);
+    prefetch_stop(batch.prefetch);
+
+    /* If we stopped early, some jobs may have completed without ever being printed. */
+    for (size_t k = 0; k < npaths; k++) clear_job(&batch.jobs[k]);
+    if (batch.stored) cache_evict(ofile->cache);
+    if (base.dedup != NULL) dedup_report(base.dedup, ofile, meta);
+
+    dedup_del(base.dedup);
+    free(batch.jobs);
+    return batch.retcode;
+}
+
+int
+open_files (const t_ofile *ofile, const t_meta *meta, const char **paths, size_t npaths, unsigned jobs) {
+
+    if (ofile->tree == NULL) return run_batch(ofile, meta, paths, npaths, jobs);
+
+    /* The objects found in the tree come after the files that were given. */
+    t_paths         tree = {0};
+    const int       walked = walk_tree(ofile, meta, ofile->tree, &tree);
+    const size_t    nall = npaths + tree.npaths;
+    const char      **all = nall ? malloc(nall * sizeof *all) : NULL;
+    int             retcode = walked;
+
+    if (nall != 0 && all == NULL) {
+
+        ft_fprintf(stderr, "%s: %s\n", meta->bin, strerror(errno));
+        retcode = EXIT_FAILURE;
+    } else if (nall != 0) {
+
+        for (size_t k = 0; k < npaths; k++) all[k] = paths[k];
+        for (size_t k = 0; k < tree.npaths; k++) all[npaths + k] = tree.paths[k];
+        if (run_batch(ofile, meta, all, nall, jobs) != EXIT_SUCCESS) retcode = EXIT_FAILURE;
+    }
 
-    munmap((void *)ofile->file, ofile->size);
+    free(all);
+    paths_del(&tree);
     return retcode;
 }
@@ -0,0 +1,145 @@
+#ifndef OFILE_H
+# define OFILE_H
+
+# include <stdbool.h>
+# include <stddef.h>
+# include <stdint.h>
+
+/*
+   libofile walks Mach-O objects, fat files and archives without printing anything. A file is opened once, its objects
+   (the file itself, each fat slice, each archive member) are pulled one at a time, and each object's load commands,
+   sections and symbols are pulled the same way with a cursor that starts zeroed:
+
+       t_of_file   *file;
+       t_of_object object;
+       t_of_error  error;
+       int         next;
+
+       if (of_open(path, &file, &error) != EXIT_SUCCESS) return report(&error);
+       while ((next = of_next_object(file, &object, &error)) != OF_END) {
+
+           t_of_cursor cursor = {0};
+           t_of_symbol symbol;
+
+           if (next == OF_ERROR) report(&error);
+           else while (of_next_symbol(&object, &cursor, &symbol, &error) == OF_NEXT) use(&symbol);
+       }
+
+       of_close(file);
+
+   Iterators return OF_NEXT with an item, OF_END once there are none left, or OF_ERROR with the error filled in. An
+   error in an archive member or a fat slice only ends that object, the next call goes on with the following one.
+   Everything handed out points into the mapped file, and stays valid until it's closed.
+*/
+
+enum                    e_of_errcode {
+    OF_E_RRNO,
+    OF_E_GARBAGE,
+    OF_E_MAGIC,
+    OF_E_INV4L,
+    OF_E_ARFMAG,
+    OF_E_AROFFSET,
+    OF_E_AROVERLAP,
+    OF_E_LOADOFF,
+    OF_E_SEGOFF,
+    OF_E_FATOFF,
+    OF_E_SYMSTRX,
+    OF_E_SYMNAME,
+    OF_E_TRIE
+};
+
+enum                    e_of_next {
+    OF_ERROR = -1,
+    OF_END,
+    OF_NEXT
+};
+
+typedef struct s_of_file t_of_file;
+
+/* OF_E_RRNO errors carry the errno they come from, or 0 when the file is just too short for what it announces. */
+
+typedef struct          s_of_error {
+    int                 errcode;
+    int                 sys_errno;
+    const char          *path;
+    const char          *member;
+    size_t              member_length;
+    uint32_t            command;
+    uint32_t            symbol;
+    int32_t             cputype;
+    int32_t             cpusubtype;
+}                       t_of_error;
+
+/* Members have a name, which isn't NUL-terminated. Fat slices and thin files don't. */
+
+typedef struct          s_of_object {
+    const void          *data;
+    size_t              size;
+    const char          *member;
+    size_t              member_length;
+    const char          *arch;
+    int32_t             cputype;
+    int32_t             cpusubtype;
+    uint32_t            filetype;
+    uint32_t            ncmds;
+    uint32_t            flags;
+    bool                is_64;
+    bool                is_cigam;
+}                       t_of_object;
+
+typedef struct          s_of_cursor {
+    size_t              offset;
+    uint32_t            k_command;
+    size_t              section;
+    uint32_t            nsects;
+    uint32_t            k_sect;
+    uint32_t            index;
+    size_t              symtab;
+    uint32_t            k_sym;
+}                       t_of_cursor;
+
+/* Fields are in the host's byte order. The data of a command is left as it is in the file. */
+
+typedef struct          s_of_command {
+    const void          *data;
+    size_t              offset;
+    uint32_t            cmd;
+    uint32_t            cmdsize;
+    uint32_t            index;
+}                       t_of_command;
+
+/* Sections are numbered from 1 across all segments, as symbols refer to them. */
+
+typedef struct          s_of_section {
+    char                segname[17];
+    char                sectname[17];
+    uint64_t            addr;
+    uint64_t            size;
+    uint32_t            offset;
+    uint32_t            flags;
+    uint32_t            index;
+}                       t_of_section;
+
+typedef struct          s_of_symbol {
+    const char          *name;
+    size_t              length;
+    uint64_t            value;
+    uint16_t            desc;
+    uint8_t             type;
+    uint8_t             sect;
+}                       t_of_symbol;
+
+void                    of_close(t_of_file *file);
+int                     of_next_command(const t_of_object *object, t_of_cursor *cursor, t_of_command *command,
+                                        t_of_error *error);
+int                     of_next_object(t_of_file *file, t_of_object *object, t_of_error *error);
+int                     of_next_section(const t_of_object *object, t_of_cursor *cursor, t_of_section *section,
+                                        t_of_error *error);
+int                     of_next_symbol(const t_of_object *object, t_of_cursor *cursor, t_of_symbol *symbol,
+                                       t_of_error *error);
+int                     of_open(const char *path, t_of_file **file, t_of_error *error);
+int                     of_open_memory(const void *data, size_t size, const char *name, t_of_file **file,
+                                       t_of_error *error);
+const char              *of_strerror(int errcode);
+
+#endif /* OFILE_H */
@@ -5,25 +5,53 @@
 # include <mach-o/loader.h>
 # include <mach-o/nlist.h>
 # include "../libft/include/libft.h"
+# include "ofile.h"
 
 # define opeek(object, offset, osize) (offset + osize > object->size ? NULL : object->object + offset)
 # define oswap_32(object, item) (object->is_cigam ? OSSwapConstInt32(item) : item)
 # define oswap_64(object, item) (object->is_cigam ? OSSwapConstInt64(item) : item)
+# define PREFETCH_DEPTH 8
+# define DEDUP_MAX (64UL << 20)
+
+/* The readers share the library's error codes, under the names they had before it. */
 
 enum                    e_errcode {
-    E_RRNO,
-    E_GARBAGE,
-    E_MAGIC,
-    E_INV4L,
-    E_ARFMAG,
-    E_AROFFSET,
-    E_AROVERLAP,
-    E_LOADOFF,
-    E_SEGOFF,
-    E_FATOFF,
-    E_SYMSTRX
+    E_RRNO = OF_E_RRNO,
+    E_GARBAGE = OF_E_GARBAGE,
+    E_MAGIC = OF_E_MAGIC,
+    E_INV4L = OF_E_INV4L,
+    E_ARFMAG = OF_E_ARFMAG,
+    E_AROFFSET = OF_E_AROFFSET,
+    E_AROVERLAP = OF_E_AROVERLAP,
+    E_LOADOFF = OF_E_LOADOFF,
+    E_SEGOFF = OF_E_SEGOFF,
+    E_FATOFF = OF_E_FATOFF,
+    E_SYMSTRX = OF_E_SYMSTRX,
+    E_SYMNAME = OF_E_SYMNAME,
+    E_TRIE = OF_E_TRIE
 };
 
+/*
+   Readers are written once as inlined functions taking the width and byte order of the object as their last two
+   arguments. OFILE_SPECIALIZE generates a copy of a reader for each of the four combinations, in which both are
+   constants, and OFILE_VARIANTS lists the copies in the order OFILE_VARIANT indexes them.
+*/
+
+# define cswap_16(is_cigam, item) ((is_cigam) ? OSSwapConstInt16(item) : (item))
+# define cswap_32(is_cigam, item) ((is_cigam) ? OSSwapConstInt32(item) : (item))
+# define cswap_64(is_cigam, item) ((is_cigam) ? OSSwapConstInt64(item) : (item))
+# define OFILE_INLINE static inline __attribute__((always_inline))
+# define OFILE_UNPACK(...) __VA_ARGS__
+# define OFILE_VARIANT(is_64, is_cigam) ((is_64) << 1 | (is_cigam))
+# define OFILE_SPECIALIZE(name, params, args) \
+    static int name##_n32 params { return name(OFILE_UNPACK args, false, false); } \
+    static int name##_s32 params { return name(OFILE_UNPACK args, false, true); } \
+    static int name##_n64 params { return name(OFILE_UNPACK args, true, false); } \
+    static int name##_s64 params { return name(OFILE_UNPACK args, true, true); }
+# define OFILE_VARIANTS(name) { \
+    [OFILE_VARIANT(false, false)] = name##_n32, [OFILE_VARIANT(false, true)] = name##_s32, \
+    [OFILE_VARIANT(true, false)] = name##_n64, [OFILE_VARIANT(true, true)] = name##_s64}
+
 enum                    e_obin {
     FT_NM,
     FT_OTOOL
@@ -42,7 +70,16 @@ enum                    e_opts {
     NM_U = (1 << 9),
     OTOOL_d = (1 << 10),
     OTOOL_h = (1 << 11),
-    OTOOL_t = (1 << 12)
+    OTOOL_t = (1 << 12),
+    NM_EXPORTS = (1 << 13),
+    OTOOL_PROBE = (1 << 14),
+    DEDUP_OUTPUT = (1 << 15)
+};
+
+enum                    e_dedup {
+    DEDUP_MISS,
+    DEDUP_CLAIMED,
+    DEDUP_FOUND
 };
 
 enum                    e_type {
@@ -56,17 +93,78 @@ typedef struct          s_object {
     const char          *name;
     size_t              size;
     const NXArchInfo    *nxArchInfo;
+    const struct dysymtab_command *dysymtab;
+    uint64_t            base;
     bool                is_64;
     bool                is_cigam;
     uint8_t             k_sect;
+    char                sections[UINT8_MAX + 1];
 }                       t_object;
 
+typedef struct s_maps   t_maps;
+typedef struct s_chunk  t_chunk;
+typedef struct s_dedup  t_dedup;
+typedef struct s_match  t_match;
+typedef struct s_prefetch t_prefetch;
+typedef struct s_stream t_stream;
+
+/* Converts count nlist or nlist_64 entries of a byte-swapped table to the host's byte order. */
+
+typedef void            (*t_swap)(void *native, const void *nlists, size_t count, bool is_64);
+
+/* Parse-time allocations come from an arena, released back to a mark once the object they belong to is done. */
+
+typedef struct          s_arena {
+    t_chunk             *chunk;
+    t_chunk             *spare;
+    size_t              used;
+}                       t_arena;
+
+typedef struct          s_mark {
+    t_chunk             *chunk;
+    size_t              used;
+}                       t_mark;
+
+/*
+   Where errors were captured in a file's output: the lengths of the output and of the errors after each error, so
+   that both can be printed in the order they were pushed.
+*/
+
+typedef struct          s_splits {
+    size_t              *ends;
+    size_t              count;
+    size_t              capacity;
+}                       t_splits;
+
+/* Paths found by walking a tree, owned by the list. */
+
+typedef struct          s_paths {
+    char                **paths;
+    size_t              npaths;
+    size_t              capacity;
+}                       t_paths;
+
 typedef struct          s_ofile {
     const char          *arch;
+    const char          *cache;
+    const char          *defines;
+    const char          *tree;
+    const t_match       *match;
     const void          *file;
+    t_arena             *arena;
     t_dstr              *buffer;
+    t_dstr              *output;
+    t_dstr              *errors;
+    t_splits            *splits;
+    t_maps              *maps;
+    t_dedup             *dedup;
+    t_stream            *stream;
     size_t              size;
-    uint16_t            opt;
+    size_t              pending;
+    size_t              flushes;
+    unsigned            jobs;
+    unsigned            prefetch;
+    uint32_t            opt;
 }                       t_ofile;
 
 typedef struct          s_meta {
@@ -87,10 +185,57 @@ typedef struct          s_meta {
         int             n_cpu;
     }                   u_n;
     uint32_t            command; //TODO put in union
-    int                 (*reader[])(t_ofile *, t_object *, struct s_meta *, size_t);
+    int                 (*const (*reader)[4])(t_ofile *, t_object *, struct s_meta *, size_t);
+    int                 (*const (*dumper)[4])(t_ofile *, t_object *, struct s_meta *, size_t);
 }                       t_meta;
 
+void                    *arena_alloc(t_arena *arena, size_t size);
+void                    arena_del(t_arena *arena);
+void                    *arena_grow(t_arena *arena, void *ptr, size_t size, size_t grown);
+t_mark                  arena_mark(const t_arena *arena);
+void                    arena_release(t_arena *arena, t_mark mark);
+void                    cache_evict(const char *dir);
+int                     cache_init(const char *dir);
+int                     cache_load(const t_ofile *ofile, const t_meta *meta, t_dstr *key, t_dstr *output);
+int                     cache_store(const t_ofile *ofile, const t_meta *meta, const t_dstr *key, const char *output);
+void                    dedup_del(t_dedup *dedup);
+void                    dedup_digest(const void *data, size_t size, uint64_t salt, uint64_t digest[2]);
+int                     dedup_find(t_dedup *dedup, const uint64_t digest[2], const void *data, uint64_t size,
+                                   const char **body, size_t *length);
+void                    dedup_keep(t_dedup *dedup, const uint64_t digest[2], const void *data, uint64_t size,
+                                   const char *body, size_t length);
+t_dedup                 *dedup_new(void);
+void                    dedup_report(const t_dedup *dedup, const t_ofile *ofile, const t_meta *meta);
+void                    hexdump(t_ofile *ofile, const t_object *object, uint64_t offset, uint64_t addr, uint64_t size);
+bool                    is_object(const char *head, size_t size);
+int                     map_file(t_ofile *ofile, t_meta *meta);
+t_maps                  *maps_new(void);
+int                     match_args(int *argc, const char **argv, t_match **match);
+void                    match_del(t_match *match);
+const char              *match_key(const t_match *match);
+bool                    match_name(const t_match *match, const char *name, size_t length);
+void                    maps_del(t_maps *maps);
 int                     open_file(t_ofile *ofile, t_meta *meta);
-int                     printerr (const t_meta *meta);
+int                     open_files(const t_ofile *ofile, const t_meta *meta, const char **paths, size_t npaths,
+                                   unsigned jobs);
+void                    paths_del(t_paths *paths);
+void                    prefetch_stop(t_prefetch *prefetch);
+t_prefetch              *prefetch_start(const char **paths, size_t npaths, unsigned depth, bool symbols);
+bool                    prefetch_take(t_prefetch *prefetch, size_t k, const void **file, size_t *size);
+int                     probe_file(t_ofile *ofile, t_meta *meta, int fd);
+int                     serve(t_ofile *ofile, t_meta *meta, const t_opt *opts, const char *address, unsigned jobs);
+void                    stream_del(t_stream *stream);
+void                    stream_drop(t_stream *stream, const void *view);
+int                     stream_file(t_ofile *ofile, t_meta *meta, int fd);
+uint64_t                stream_reach(t_stream *stream, uint64_t end);
+size_t                  stream_read(t_stream *stream, uint64_t start, void *buff, size_t size);
+const void              *stream_view(t_stream *stream, uint64_t start, uint64_t end, size_t *size);
+t_swap                  swap_kernel(void);
+void                    unmap_file(const t_ofile *ofile);
+int                     walk_tree(const t_ofile *ofile, const t_meta *meta, const char *root, t_paths *paths);
+int                     write_all(int fd, const char *buff, size_t size);
+void                    push_output(t_ofile *ofile, const char *block, size_t size);
+int                     pool_run(size_t ntasks, unsigned nthreads, void (*task)(void *, size_t),
+                                 int (*emit)(void *, size_t), void *ctx);
 
 #endif /* OFILEP_H */
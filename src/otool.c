@@ -1,99 +1,127 @@
 #include "ofilep.h"
 
-
 static void
-hexdump (t_ofile *ofile, const t_object *object, const uint64_t offset, const uint64_t addr, const uint64_t size) {
-
-    uint32_t    *ptr = (uint32_t *)(object->object + offset);
-    const bool  dbyte = (object->nxArchInfo == NULL
-            || (object->nxArchInfo->cputype != CPU_TYPE_I386 && object->nxArchInfo->cputype != CPU_TYPE_X86_64));
-
-    for (uint64_t k = 0; k < size; k++) {
-
-        if (k % 16 == 0) ft_dstrfpush(ofile->buffer, "%0*llx\t", (object->is_64 ? 16 : 8), addr + k);
-        if (dbyte == true) {
-
-            ft_dstrfpush(ofile->buffer, "%08x ", oswap_32(object, *(ptr + k / 4)));
-            k += 3;
-        } else {
+dump_section (t_ofile *ofile, const t_object *object, const char *segname, const char *sectname, uint64_t offset,
+        uint64_t addr, uint64_t size) {
 
-            ft_dstrfpush(ofile->buffer, "%02x ", ((unsigned char *)ptr)[k]);
-        }
+    if ((ft_strequ(segname, SEG_TEXT) && ft_strequ(sectname, SECT_TEXT) && ofile->opt & OTOOL_t)
+    || (ft_strequ(segname, SEG_DATA) && ft_strequ(sectname, SECT_DATA) && ofile->opt & OTOOL_d)) {
 
-        if (k % 16 == 15 || k + 1 == size) ft_dstrfpush(ofile->buffer, "\n");
+        ft_dstrfpush(ofile->buffer, "Contents of (%s,%s) section\n", segname, sectname);
+        hexdump(ofile, object, offset, addr, size);
     }
 }
 
-static int
-segment (t_ofile *ofile, t_object *object, t_meta *meta, size_t offset) {
+OFILE_INLINE int
+segment (t_ofile *ofile, t_object *object, t_meta *meta, size_t offset, const bool is_64,
+        const bool is_cigam) {
 
+    (void)ofile, (void)is_64;
     struct segment_command *segment = (struct segment_command *)opeek(object, offset, sizeof *segment);
     if (segment == NULL) return (meta->errcode = E_GARBAGE), EXIT_FAILURE;
 
-    if (oswap_32(object, segment->fileoff) + oswap_32(object, segment->filesize) > object->size) {
+    if (cswap_32(is_cigam, segment->fileoff) + cswap_32(is_cigam, segment->filesize) > object->size) {
 
         meta->errcode = E_SEGOFF;
-        meta->command = oswap_32(object, segment->cmd);
+        meta->command = cswap_32(is_cigam, segment->cmd);
         return EXIT_FAILURE;
     }
 
     offset += sizeof *segment;
-    const uint32_t nsects = oswap_32(object, segment->nsects);
+    const uint32_t nsects = cswap_32(is_cigam, segment->nsects);
     for (uint32_t k = 0; k < nsects; k++) {
 
-        const struct section *section = (struct section *)opeek(object, offset, sizeof *section);
-        if (section == NULL) return (meta->errcode = E_GARBAGE), EXIT_FAILURE;
-
-        if ((ft_strequ(section->segname, SEG_TEXT) && ft_strequ(section->sectname, SECT_TEXT) && ofile->opt & OTOOL_t)
-        || (ft_strequ(section->segname, SEG_DATA) && ft_strequ(section->sectname, SECT_DATA) && ofile->opt & OTOOL_d)) {
-
-            ft_dstrfpush(ofile->buffer, "Contents of (%s,%s) section\n", section->segname, section->sectname);
-            hexdump(ofile, object, oswap_32(object, section->offset), oswap_32(object, section->addr),
-                    oswap_32(object, section->size));
-        }
-
-        offset += sizeof *section;
+        if (opeek(object, offset, sizeof(struct section)) == NULL) return (meta->errcode = E_GARBAGE), EXIT_FAILURE;
+        offset += sizeof(struct section);
     }
 
     return EXIT_SUCCESS;
 }
 
-static int
-segment_64 (t_ofile *ofile, t_object *object, t_meta *meta, size_t offset) {
+OFILE_SPECIALIZE(segment, (t_ofile *ofile, t_object *object, t_meta *meta, size_t offset),
+        (ofile, object, meta, offset))
 
+OFILE_INLINE int
+segment_64 (t_ofile *ofile, t_object *object, t_meta *meta, size_t offset, const bool is_64,
+        const bool is_cigam) {
+
+    (void)ofile, (void)is_64;
     struct segment_command_64 *segment = (struct segment_command_64 *)(object->object + offset);
     if (segment == NULL) return (meta->errcode = E_GARBAGE), EXIT_FAILURE;
 
-    if (oswap_64(object, segment->fileoff) + oswap_64(object, segment->filesize) > object->size) {
+    if (cswap_64(is_cigam, segment->fileoff) + cswap_64(is_cigam, segment->filesize) > object->size) {
 
         meta->errcode = E_SEGOFF;
-        meta->command = oswap_32(object, segment->cmd);
+        meta->command = cswap_32(is_cigam, segment->cmd);
         return EXIT_FAILURE;
     }
 
     offset += sizeof *segment;
-    const uint32_t nsects = oswap_32(object, segment->nsects);
+    const uint32_t nsects = cswap_32(is_cigam, segment->nsects);
     for (uint32_t k = 0; k < nsects; k++) {
 
-        const struct section_64 *section = (struct section_64 *)opeek(object, offset, sizeof *section);
-        if (section == NULL) return (meta->errcode = E_GARBAGE), EXIT_FAILURE;
+        if (opeek(object, offset, sizeof(struct section_64)) == NULL) return (meta->errcode = E_GARBAGE), EXIT_FAILURE;
+        offset += sizeof(struct section_64);
+    }
 
-        if ((ft_strequ(section->segname, SEG_TEXT) && ft_strequ(section->sectname, SECT_TEXT) && ofile->opt & OTOOL_t)
-        || (ft_strequ(section->segname, SEG_DATA) && ft_strequ(section->sectname, SECT_DATA) && ofile->opt & OTOOL_d)) {
+    return EXIT_SUCCESS;
+}
 
-            ft_dstrfpush(ofile->buffer, "Contents of (%s,%s) section\n", section->segname, section->sectname);
-            hexdump(ofile, object, oswap_32(object, section->offset), oswap_64(object, section->addr),
-                    oswap_64(object, section->size));
-        }
+OFILE_SPECIALIZE(segment_64, (t_ofile *ofile, t_object *object, t_meta *meta, size_t offset),
+        (ofile, object, meta, offset))
+
+/*
+   The sections are dumped once the whole object has been checked, by going through the segments a second time. By
+   then their output can be written as it's produced.
+*/
+
+OFILE_INLINE int
+sections (t_ofile *ofile, t_object *object, t_meta *meta, size_t offset, const bool is_64,
+        const bool is_cigam) {
+
+    (void)meta, (void)is_64;
+    const struct segment_command *segment = (struct segment_command *)(object->object + offset);
+    const uint32_t nsects = cswap_32(is_cigam, segment->nsects);
+
+    offset += sizeof *segment;
+    for (uint32_t k = 0; k < nsects; k++, offset += sizeof(struct section)) {
 
-        offset += sizeof *section;
+        const struct section *section = (struct section *)(object->object + offset);
+        dump_section(ofile, object, section->segname, section->sectname, cswap_32(is_cigam, section->offset),
+                cswap_32(is_cigam, section->addr), cswap_32(is_cigam, section->size));
     }
 
     return EXIT_SUCCESS;
 }
 
-static int
-symtab_check (t_ofile *ofile, t_object *object, t_meta *meta, size_t offset) {
+OFILE_SPECIALIZE(sections, (t_ofile *ofile, t_object *object, t_meta *meta, size_t offset),
+        (ofile, object, meta, offset))
+
+OFILE_INLINE int
+sections_64 (t_ofile *ofile, t_object *object, t_meta *meta, size_t offset, const bool is_64,
+        const bool is_cigam) {
+
+    (void)meta, (void)is_64;
+    const struct segment_command_64 *segment = (struct segment_command_64 *)(object->object + offset);
+    const uint32_t nsects = cswap_32(is_cigam, segment->nsects);
+
+    offset += sizeof *segment;
+    for (uint32_t k = 0; k < nsects; k++, offset += sizeof(struct section_64)) {
+
+        const struct section_64 *section = (struct section_64 *)(object->object + offset);
+        dump_section(ofile, object, section->segname, section->sectname, cswap_32(is_cigam, section->offset),
+                cswap_64(is_cigam, section->addr), cswap_64(is_cigam, section->size));
+    }
+
+    return EXIT_SUCCESS;
+}
+
+OFILE_SPECIALIZE(sections_64, (t_ofile *ofile, t_object *object, t_meta *meta, size_t offset),
+        (ofile, object, meta, offset))
+
+OFILE_INLINE int
+symtab_check (t_ofile *ofile, t_object *object, t_meta *meta, size_t offset, const bool is_64,
+        const bool is_cigam) {
 
     /* This function merely serves to check corrupted files. We won't output or need anything from it. */
 
@@ -101,54 +129,83 @@ symtab_check (t_ofile *ofile, t_object *object, t_meta *meta, size_t offset) {
     const struct symtab_command *symtab = (struct symtab_command *)opeek(object, offset, sizeof *symtab);
     if (symtab == NULL) return EXIT_FAILURE; /* E_RRNO */
 
-    const uint32_t stroff = oswap_32(object, symtab->stroff);
-    const uint32_t strsize = oswap_32(object, symtab->strsize);
-    offset = oswap_32(object, symtab->symoff);
+    const uint32_t stroff = cswap_32(is_cigam, symtab->stroff);
+    const uint32_t strsize = cswap_32(is_cigam, symtab->strsize);
+    const uint32_t nsyms = cswap_32(is_cigam, symtab->nsyms);
+    offset = cswap_32(is_cigam, symtab->symoff);
 
-    for (meta->u_k.k_strindex = 0; meta->u_k.k_strindex < oswap_32(object, symtab->nsyms); meta->u_k.k_strindex++) {
+    for (meta->u_k.k_strindex = 0; meta->u_k.k_strindex < nsyms; meta->u_k.k_strindex++) {
 
         const struct nlist *nlist = (struct nlist *)opeek(object, offset, sizeof *nlist);
         if (nlist == NULL) return EXIT_FAILURE; /* E_RRNO */
 
-        const uint32_t n_strx = oswap_32(object, nlist->n_un.n_strx);
+        const uint32_t n_strx = cswap_32(is_cigam, nlist->n_un.n_strx);
         if (stroff + n_strx > object->size) {
 
             meta->errcode = E_SYMSTRX;
-            meta->u_n.n_strindex = (int)(stroff + strsize + n_strx - ofile->size);
+            /* The index is given past the end of the file, which a stream only knows once read to its end. */
+            meta->u_n.n_strindex = (int)(stroff + strsize + n_strx -
+                    (ofile->stream != NULL ? stream_reach(ofile->stream, UINT64_MAX) : ofile->size));
             return EXIT_FAILURE;
         }
 
-        offset += (object->is_64 ? sizeof(struct nlist_64) : sizeof(struct nlist));
+        offset += (is_64 ? sizeof(struct nlist_64) : sizeof(struct nlist));
     }
 
     return EXIT_SUCCESS;
 }
 
+OFILE_SPECIALIZE(symtab_check, (t_ofile *ofile, t_object *object, t_meta *meta, size_t offset),
+        (ofile, object, meta, offset))
+
 int
 main (int argc, const char *argv[]) {
 
-    int             index = 1, retcode = EXIT_SUCCESS;
-    static t_dstr   buffer;
-    static t_meta   meta = {
+    int             index = 1;
+    const char      *jobs = NULL;
+    const char      *address = NULL;
+    const char      *prefetch = NULL;
+    static int      (*const reader[][4])(t_ofile *, t_object *, t_meta *, size_t) = {
+            [LC_SEGMENT] = OFILE_VARIANTS(segment),
+            [LC_SEGMENT_64] = OFILE_VARIANTS(segment_64),
+            [LC_SYMTAB] = OFILE_VARIANTS(symtab_check)
+    };
+    static int      (*const dumper[][4])(t_ofile *, t_object *, t_meta *, size_t) = {
+            [LC_SEGMENT] = OFILE_VARIANTS(sections),
+            [LC_SEGMENT_64] = OFILE_VARIANTS(sections_64)
+    };
+    t_meta          meta = {
             .obin = FT_OTOOL,
-            .reader = {
-                    [LC_SEGMENT] = segment,
-                    [LC_SEGMENT_64] = segment_64,
-                    [LC_SYMTAB] = symtab_check
-            }
+            .reader = reader,
+            .dumper = dumper
     };
     t_ofile         ofile = {
             .arch = NULL,
-            .buffer = &buffer,
             .opt = NAME_OUTPUT
     };
     const t_opt     opts[] = {
             {FT_OPT_BOOLEAN, 'd', "data", &ofile.opt, "Display the contents of the (__DATA, __data) section.", OTOOL_d},
             {FT_OPT_BOOLEAN, 'h', "header", &ofile.opt, "Display the Mach header.", OTOOL_h},
+            {FT_OPT_BOOLEAN, 0, "probe", &ofile.opt, "Display the Mach header like -h, reading only the headers and "
+                "load commands of each file rather than mapping it whole.", OTOOL_h | OTOOL_PROBE},
+            {FT_OPT_BOOLEAN, 0, "dedup", &ofile.opt, "Dump fat slices and archive members identical to one dumped "
+                "before from what was printed for it, and report how many were.", DEDUP_OUTPUT},
             {FT_OPT_BOOLEAN, 't', "text", &ofile.opt, "Display the contents of the (__TEXT,__text) section.", OTOOL_t},
             {FT_OPT_STRING, 0, "arch", &ofile.arch, "Specifies the architecture of the file to display when the file "
                 "is a fat binary. \"all\" can be specified to display all architectures in the file. The default is to "
                 "display only the host architecture.", 0},
+            {FT_OPT_STRING, 'j', "jobs", &jobs, "Process up to N files in parallel, and dump large sections with up "
+                "to N threads. Output is still printed in the order the files were given.", 0},
+            {FT_OPT_STRING, 0, "prefetch", &prefetch, "Map and read ahead up to N of the files that follow the ones "
+                "being read, in the background. 0 turns it off, the default is 8.", 0},
+            {FT_OPT_STRING, 'R', "recursive", &ofile.tree, "Also process the objects found in DIR and the directories "
+                "under it, in name order. Files that aren't objects, fat files or archives are skipped.", 0},
+            {FT_OPT_STRING, 0, "cache", &ofile.cache, "Keep the output of each file in DIR, and reuse it for as long "
+                "as the file and the options don't change.", 0},
+            {FT_OPT_STRING, 0, "serve", &address, "Answer requests read from a UNIX socket at ADDRESS, or from stdin "
+                "if ADDRESS is \"-\". A request is a line of options and files, the options given here are its "
+                "defaults. Requests can't give --prefetch, --serve nor --cache. The socket is only open to the user "
+                "running the server.", 0},
             {FT_OPT_END, 0, 0, 0, 0, 0}
     };
 
@@ -170,23 +227,21 @@ main (int argc, const char *argv[]) {
         ft_optusage(opts, (char *)argv[0], "[file(s)]", "Hexdump [file(s)] (a.out by default).");
         return EXIT_FAILURE;
     }
-    if (ofile.opt < OTOOL_d) return ft_fprintf(stderr, "%s: one of -dht must be specified.\n", argv[0]), EXIT_FAILURE;
-    if (argc == index) argv[argc++] = "a.out";
-
-    meta.bin = argv[0];
-    for ( ; index < argc; index++) {
-
-        meta.path = argv[index];
-        meta.errcode = E_RRNO;
-        meta.type = E_MACHO;
-        if (open_file(&ofile, &meta) != EXIT_SUCCESS) {
+    if (jobs && ft_atoi(jobs) < 1)
+        return ft_fprintf(stderr, "%s: invalid number of jobs: \'%s\'\n", argv[0], jobs), EXIT_FAILURE;
+    if (prefetch && ft_atoi(prefetch) < 0)
+        return ft_fprintf(stderr, "%s: invalid prefetch depth: \'%s\'\n", argv[0], prefetch), EXIT_FAILURE;
+    ofile.prefetch = prefetch ? (unsigned)ft_atoi(prefetch) : PREFETCH_DEPTH;
 
-            printerr(&meta);
-            retcode = EXIT_FAILURE;
+    if (ofile.cache && cache_init(ofile.cache) == EXIT_FAILURE)
+        return ft_fprintf(stderr, "%s: %s: %s\n", argv[0], ofile.cache, strerror(errno)), EXIT_FAILURE;
 
-            if (meta.errcode == E_RRNO) break;
-        }
-    }
+    /* The server checks -dht per request, as each request may pick its own. */
+    meta.bin = argv[0];
+    if (address != NULL) return serve(&ofile, &meta, opts, address, jobs ? (unsigned)ft_atoi(jobs) : 1);
+    if ((ofile.opt & (OTOOL_d | OTOOL_h | OTOOL_t)) == 0)
+        return ft_fprintf(stderr, "%s: one of -dht must be specified.\n", argv[0]), EXIT_FAILURE;
+    if (argc == index && ofile.tree == NULL) argv[argc++] = "a.out";
 
-    return retcode;
+    return open_files(&ofile, &meta, argv + index, (size_t)(argc - index), jobs ? (unsigned)ft_atoi(jobs) : 1);
 }
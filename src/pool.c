@@ -0,0 +1,301 @@
+#include "ofilep.h"
+#include <pthread.h>
+
+typedef struct          s_group {
+    void                (*task)(void *, size_t);
+    void                *ctx;
+    bool                *done;
+    size_t              ntasks;
+    size_t              next;
+    bool                stop;
+}                       t_group;
+
+typedef struct          s_task {
+    t_group             *group;
+    size_t              k;
+}                       t_task;
+
+typedef struct          s_deque {
+    pthread_mutex_t     lock;
+    t_task              *tasks;
+    size_t              head;
+    size_t              tail;
+    size_t              capacity;
+}                       t_deque;
+
+typedef struct          s_worker {
+    struct s_pool       *pool;
+    t_deque             deque;
+    pthread_t           thread;
+}                       t_worker;
+
+typedef struct          s_pool {
+    pthread_mutex_t     lock;
+    pthread_cond_t      pushed;
+    pthread_cond_t      finished;
+    t_group             *top;
+    t_worker            *workers;
+    unsigned            nworkers;
+    unsigned long       epoch;
+    bool                stop;
+}                       t_pool;
+
+/* The worker the current thread is, if it's one. */
+static _Thread_local t_worker   *self;
+
+static bool
+push_group (t_worker *worker, t_group *group) {
+
+    t_deque *deque = &worker->deque;
+    t_pool  *pool = worker->pool;
+
+    pthread_mutex_lock(&deque->lock);
+    if (deque->head == deque->tail) deque->head = deque->tail = 0;
+    if (deque->tail + group->ntasks > deque->capacity) {
+
+        const size_t    capacity = (deque->tail + group->ntasks) * 2;
+        t_task          *tasks = realloc(deque->tasks, capacity * sizeof *tasks);
+
+        if (tasks == NULL) {
+
+            pthread_mutex_unlock(&deque->lock);
+            return false;
+        }
+
+        deque->tasks = tasks;
+        deque->capacity = capacity;
+    }
+
+    /* The owner takes tasks from the tail and thieves from the head, so the owner starts with the first task. */
+    for (size_t k = group->ntasks; k > 0; k--) deque->tasks[deque->tail++] = (t_task){.group = group, .k = k - 1};
+    pthread_mutex_unlock(&deque->lock);
+
+    pthread_mutex_lock(&pool->lock);
+    pool->epoch++;
+    pthread_cond_broadcast(&pool->pushed);
+    pthread_cond_broadcast(&pool->finished);
+    pthread_mutex_unlock(&pool->lock);
+    return true;
+}
+
+static bool
+take_task (t_deque *deque, t_task *task, bool steal) {
+
+    bool found = false;
+
+    pthread_mutex_lock(&deque->lock);
+    if (deque->head < deque->tail) {
+
+        *task = steal ? deque->tasks[deque->head++] : deque->tasks[--deque->tail];
+        found = true;
+    }
+
+    pthread_mutex_unlock(&deque->lock);
+    return found;
+}
+
+static bool
+find_task (t_worker *worker, t_task *task, bool claim) {
+
+    t_pool          *pool = worker->pool;
+    const unsigned  id = (unsigned)(worker - pool->workers);
+
+    /*
+       Our own tasks come first, then those we can steal from the others, starting with our neighbour. Files are only
+       claimed once there is nothing left to steal, and never by a worker waiting on its own tasks, as a whole file
+       would hold up the output of the one it's in the middle of.
+    */
+
+    if (take_task(&worker->deque, task, false)) return true;
+    for (unsigned k = 1; k < pool->nworkers; k++)
+        if (take_task(&pool->workers[(id + k) % pool->nworkers].deque, task, true)) return true;
+    if (claim == false) return false;
+
+    pthread_mutex_lock(&pool->lock);
+    const bool found = pool->stop == false && pool->top->next < pool->top->ntasks;
+    if (found) *task = (t_task){.group = pool->top, .k = pool->top->next++};
+    pthread_mutex_unlock(&pool->lock);
+    return found;
+}
+
+static void
+run_task (t_pool *pool, t_task task) {
+
+    pthread_mutex_lock(&pool->lock);
+    const bool skip = task.group->stop;
+    pthread_mutex_unlock(&pool->lock);
+
+    /* Tasks of a group that was stopped are skipped, but still count as done so their owner can leave. */
+    if (skip == false) task.group->task(task.group->ctx, task.k);
+
+    pthread_mutex_lock(&pool->lock);
+    task.group->done[task.k] = true;
+    pthread_cond_broadcast(&pool->finished);
+    pthread_mutex_unlock(&pool->lock);
+}
+
+static void
+help_until (t_worker *worker, const bool *done, bool claim) {
+
+    t_pool  *pool = worker->pool;
+    t_task  task;
+
+    /*
+       Run whatever can be found until the task is done, or until the pool stops when there is none. We only sleep if
+       nothing was pushed since we last looked, and wake up whenever something is pushed, or when a task completes if
+       we are waiting on one.
+    */
+
+    while (true) {
+
+        pthread_mutex_lock(&pool->lock);
+        const bool              finished = (done != NULL) ? *done : pool->stop;
+        const unsigned long     epoch = pool->epoch;
+        pthread_mutex_unlock(&pool->lock);
+        if (finished) return;
+
+        if (find_task(worker, &task, claim)) {
+
+            run_task(pool, task);
+            continue;
+        }
+
+        pthread_mutex_lock(&pool->lock);
+        while (epoch == pool->epoch && ((done != NULL) ? *done : pool->stop) == false)
+            pthread_cond_wait(done != NULL ? &pool->finished : &pool->pushed, &pool->lock);
+        pthread_mutex_unlock(&pool->lock);
+    }
+}
+
+static void *
+work (void *arg) {
+
+    self = arg;
+    help_until(self, NULL, true);
+    return NULL;
+}
+
+static int
+run_serial (size_t ntasks, void (*task)(void *, size_t), int (*emit)(void *, size_t), void *ctx) {
+
+    for (size_t k = 0; k < ntasks; k++) {
+
+        task(ctx, k);
+        if (emit(ctx, k) != EXIT_SUCCESS) return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
+
+static int
+run_group (t_worker *worker, size_t ntasks, void (*task)(void *, size_t), int (*emit)(void *, size_t), void *ctx) {
+
+    t_group group = {.task = task, .ctx = ctx, .done = calloc(ntasks, sizeof(bool)), .ntasks = ntasks};
+    int     retcode = EXIT_SUCCESS;
+    size_t  k = 0;
+
+    /*
+       From inside a task, the tasks are pushed on our own deque for other workers to steal, rather than run on threads
+       of their own. We work through them and emit them in order, and help with whatever else we find while waiting.
+    */
+
+    if (group.done == NULL || push_group(worker, &group) == false) {
+
+        free(group.done);
+        return run_serial(ntasks, task, emit, ctx);
+    }
+
+    for ( ; k < ntasks; k++) {
+
+        help_until(worker, &group.done[k], false);
+        if (emit(ctx, k) != EXIT_SUCCESS) {
+
+            retcode = EXIT_FAILURE;
+            break;
+        }
+    }
+
+    /* Tasks still queued are skipped, but the group can't go away before every one of them is out of the deques. */
+    if (k < ntasks) {
+
+        pthread_mutex_lock(&worker->pool->lock);
+        group.stop = true;
+        pthread_mutex_unlock(&worker->pool->lock);
+        for ( ; k < ntasks; k++) help_until(worker, &group.done[k], false);
+    }
+
+    free(group.done);
+    return retcode;
+}
+
+int
+pool_run (size_t ntasks, unsigned nthreads, void (*task)(void *, size_t), int (*emit)(void *, size_t), void *ctx) {
+
+    /*
+       Only the outermost call starts threads, the calls made from its tasks hand their tasks to the same workers. It
+       does so even for a single task, as that task may split into more: the passes of a large sort or the windows of
+       a large section would otherwise start and join threads of their own, over and over.
+    */
+
+    if (self != NULL && nthreads > 1 && ntasks > 1) return run_group(self, ntasks, task, emit, ctx);
+    if (nthreads <= 1 || ntasks == 0 || self != NULL) return run_serial(ntasks, task, emit, ctx);
+
+    t_group     top = {.task = task, .ctx = ctx, .done = calloc(ntasks, sizeof(bool)), .ntasks = ntasks};
+    t_pool      pool = {
+            .lock = PTHREAD_MUTEX_INITIALIZER,
+            .pushed = PTHREAD_COND_INITIALIZER,
+            .finished = PTHREAD_COND_INITIALIZER,
+            .top = &top,
+            .workers = calloc(nthreads, sizeof(t_worker)),
+            .nworkers = nthreads
+    };
+    unsigned    nstarted = 0;
+
+    /*
+       Each worker has a deque of the tasks it split its own task into, which the others steal from once they have run
+       out of work. Tasks given here are claimed in order by whoever is free, and emitted in order as they complete.
+    */
+
+    for (unsigned k = 0; pool.workers != NULL && k < nthreads; k++) {
+
+        pool.workers[k].pool = &pool;
+        pthread_mutex_init(&pool.workers[k].deque.lock, NULL);
+    }
+
+    for ( ; top.done != NULL && pool.workers != NULL && nstarted < nthreads; nstarted++)
+        if (pthread_create(&pool.workers[nstarted].thread, NULL, work, &pool.workers[nstarted]) != 0) break;
+
+    /* If we couldn't get a single thread, we just run everything ourselves. */
+    int retcode = EXIT_SUCCESS;
+    if (nstarted == 0) retcode = run_serial(ntasks, task, emit, ctx);
+    for (size_t k = 0; nstarted > 0 && k < ntasks; k++) {
+
+        pthread_mutex_lock(&pool.lock);
+        while (top.done[k] == false) pthread_cond_wait(&pool.finished, &pool.lock);
+        pthread_mutex_unlock(&pool.lock);
+
+        if (emit(ctx, k) != EXIT_SUCCESS) {
+
+            retcode = EXIT_FAILURE;
+            break;
+        }
+    }
+
+    /* Files still unclaimed are skipped, running ones are waited for, their output will never be emitted. */
+    pthread_mutex_lock(&pool.lock);
+    pool.stop = true;
+    top.stop = true;
+    pthread_cond_broadcast(&pool.pushed);
+    pthread_mutex_unlock(&pool.lock);
+
+    for (unsigned k = 0; k < nstarted; k++) pthread_join(pool.workers[k].thread, NULL);
+    for (unsigned k = 0; pool.workers != NULL && k < nthreads; k++) {
+
+        pthread_mutex_destroy(&pool.workers[k].deque.lock);
+        free(pool.workers[k].deque.tasks);
+    }
+
+    free(pool.workers);
+    free(top.done);
+    return retcode;
+}
@@ -0,0 +1,222 @@
+#include "ofilep.h"
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+enum                    e_slot {
+    SLOT_EMPTY,
+    SLOT_BUSY,
+    SLOT_READY,
+    SLOT_TAKEN
+};
+
+typedef struct          s_slot {
+    const void          *file;
+    size_t              size;
+    enum e_slot         state;
+}                       t_slot;
+
+struct                  s_prefetch {
+    pthread_mutex_t     lock;
+    pthread_cond_t      changed;
+    pthread_t           thread;
+    const char          **paths;
+    t_slot              *slots;
+    size_t              npaths;
+    size_t              started;
+    unsigned            depth;
+    bool                symbols;
+    bool                stop;
+};
+
+static void
+advise (const void *file, size_t size, uint64_t offset, uint64_t length) {
+
+    const uintptr_t page = (uintptr_t)sysconf(_SC_PAGESIZE);
+    const uintptr_t base = (uintptr_t)file;
+
+    if (offset >= size) return;
+    if (length > size - offset) length = size - offset;
+
+    /* The range is widened to the pages it touches, as madvise() wants its start on a page boundary. */
+    const uintptr_t start = (base + offset) & ~(page - 1);
+
+    madvise((void *)start, base + offset + length - start, MADV_WILLNEED);
+}
+
+static void
+warm (const t_prefetch *prefetch, const void *file, size_t size) {
+
+    const uint32_t  magic = *(const uint32_t *)file;
+    const bool      is_64 = magic == MH_MAGIC_64 || magic == MH_CIGAM_64;
+    const bool      is_cigam = magic == MH_CIGAM || magic == MH_CIGAM_64;
+    const size_t    header = is_64 ? sizeof(struct mach_header_64) : sizeof(struct mach_header);
+
+    /*
+       nm only reads the load commands and the symbol and string tables of a thin object, which are asked for on
+       their own. Anything else, fat files and archives included, is read ahead whole. Reading the header here waits
+       on its first page, but it's this thread that waits, not the one parsing.
+    */
+
+    if (prefetch->symbols == false || size < header
+        || (magic != MH_MAGIC && magic != MH_CIGAM && magic != MH_MAGIC_64 && magic != MH_CIGAM_64)) {
+
+        advise(file, size, 0, size);
+        return;
+    }
+
+    const struct mach_header *mach_header = file;
+    const uint32_t ncmds = cswap_32(is_cigam, mach_header->ncmds);
+    size_t offset = header;
+
+    for (uint32_t k = 0; k < ncmds && offset + sizeof(struct load_command) <= size; k++) {
+
+        const struct load_command *command = (const struct load_command *)((const char *)file + offset);
+        const uint32_t cmdsize = cswap_32(is_cigam, command->cmdsize);
+
+        if (cmdsize < sizeof *command || offset + cmdsize > size) break;
+        if (cswap_32(is_cigam, command->cmd) == LC_SYMTAB && cmdsize >= sizeof(struct symtab_command)) {
+
+            const struct symtab_command *symtab = (const struct symtab_command *)command;
+            const size_t nlist_size = is_64 ? sizeof(struct nlist_64) : sizeof(struct nlist);
+
+            advise(file, size, cswap_32(is_cigam, symtab->symoff),
+                    (uint64_t)cswap_32(is_cigam, symtab->nsyms) * nlist_size);
+            advise(file, size, cswap_32(is_cigam, symtab->stroff), cswap_32(is_cigam, symtab->strsize));
+        }
+
+        offset += cmdsize;
+    }
+}
+
+static bool
+load (t_prefetch *prefetch, t_slot *slot, const char *path) {
+
+    struct stat info;
+
+    /*
+       The descriptor is closed as soon as the file is mapped, so there is never more than one open here, however
+       deep the prefetch. Files that can't be mapped are left for the parse to open, which reports why. "-" is stdin,
+       and anything but a regular file is left alone before it is opened: opening a FIFO would wait for a writer, and
+       take its data from the parse. O_NONBLOCK covers a path replaced by one between the two calls.
+    */
+
+    if (ft_strequ(path, "-") || stat(path, &info) == -1 || S_ISREG(info.st_mode) == 0) return false;
+
+    const int fd = open(path, O_RDONLY | O_NONBLOCK);
+
+    if (fd == -1) return false;
+    if (fstat(fd, &info) == -1 || S_ISREG(info.st_mode) == 0 || (size_t)info.st_size < sizeof(uint32_t)) {
+
+        close(fd);
+        return false;
+    }
+
+    slot->size = (size_t)info.st_size;
+    slot->file = mmap(NULL, slot->size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (slot->file == MAP_FAILED) return (slot->file = NULL), false;
+
+    warm(prefetch, slot->file, slot->size);
+    return true;
+}
+
+static void *
+run (void *arg) {
+
+    t_prefetch *prefetch = arg;
+
+    /* Files are mapped in order, never more than depth past the last one the parse started on. */
+    pthread_mutex_lock(&prefetch->lock);
+    for (size_t k = 0; k < prefetch->npaths && prefetch->stop == false; k++) {
+
+        while (prefetch->stop == false && k >= prefetch->started + prefetch->depth)
+            pthread_cond_wait(&prefetch->changed, &prefetch->lock);
+        if (prefetch->stop || prefetch->slots[k].state != SLOT_EMPTY) continue;
+
+        prefetch->slots[k].state = SLOT_BUSY;
+        pthread_mutex_unlock(&prefetch->lock);
+
+        const bool loaded = load(prefetch, &prefetch->slots[k], prefetch->paths[k]);
+
+        pthread_mutex_lock(&prefetch->lock);
+        prefetch->slots[k].state = loaded ? SLOT_READY : SLOT_TAKEN;
+        pthread_cond_broadcast(&prefetch->changed);
+    }
+
+    pthread_mutex_unlock(&prefetch->lock);
+    return NULL;
+}
+
+t_prefetch *
+prefetch_start (const char **paths, size_t npaths, unsigned depth, bool symbols) {
+
+    t_prefetch *prefetch = calloc(1, sizeof(t_prefetch));
+
+    if (prefetch == NULL) return NULL;
+    *prefetch = (t_prefetch){
+            .lock = PTHREAD_MUTEX_INITIALIZER,
+            .changed = PTHREAD_COND_INITIALIZER,
+            .paths = paths,
+            .slots = calloc(npaths, sizeof(t_slot)),
+            .npaths = npaths,
+            .depth = depth,
+            .symbols = symbols
+    };
+
+    if (prefetch->slots == NULL || pthread_create(&prefetch->thread, NULL, run, prefetch) != 0) {
+
+        free(prefetch->slots);
+        free(prefetch);
+        return NULL;
+    }
+
+    return prefetch;
+}
+
+bool
+prefetch_take (t_prefetch *prefetch, size_t k, const void **file, size_t *size) {
+
+    t_slot *slot = &prefetch->slots[k];
+
+    /*
+       Starting on a file moves the window forward. A file being mapped is waited for, as its reads are already on
+       their way. One the prefetch hasn't reached yet is taken from it, and opened the usual way.
+    */
+
+    pthread_mutex_lock(&prefetch->lock);
+    if (k + 1 > prefetch->started) prefetch->started = k + 1;
+    pthread_cond_broadcast(&prefetch->changed);
+    while (slot->state == SLOT_BUSY) pthread_cond_wait(&prefetch->changed, &prefetch->lock);
+
+    const bool ready = slot->state == SLOT_READY;
+
+    slot->state = SLOT_TAKEN;
+    pthread_mutex_unlock(&prefetch->lock);
+
+    if (ready) *file = slot->file, *size = slot->size;
+    return ready;
+}
+
+void
+prefetch_stop (t_prefetch *prefetch) {
+
+    if (prefetch == NULL) return;
+
+    pthread_mutex_lock(&prefetch->lock);
+    prefetch->stop = true;
+    pthread_cond_broadcast(&prefetch->changed);
+    pthread_mutex_unlock(&prefetch->lock);
+    pthread_join(prefetch->thread, NULL);
+
+    /* Files mapped ahead of a batch that stopped early were never taken. */
+    for (size_t k = 0; k < prefetch->npaths; k++)
+        if (prefetch->slots[k].state == SLOT_READY) munmap((void *)prefetch->slots[k].file, prefetch->slots[k].size);
+
+    pthread_mutex_destroy(&prefetch->lock);
+    pthread_cond_destroy(&prefetch->changed);
+    free(prefetch->slots);
+    free(prefetch);
+}
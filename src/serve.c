@@ -0,0 +1,377 @@
+#include "ofilep.h"
+#include <pthread.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#define REQUEST_MAX 16384
+#define ARGS_MAX 256
+
+typedef struct          s_reader {
+    int                 fd;
+    size_t              start;
+    size_t              end;
+    char                buff[REQUEST_MAX];
+}                       t_reader;
+
+typedef struct          s_server {
+    t_ofile             *ofile;
+    t_ofile             base;
+    t_meta              *meta;
+    const t_opt         *opts;
+    t_maps              *maps;
+    unsigned            jobs;
+    pthread_mutex_t     lock;
+    pthread_cond_t      idle;
+    unsigned            clients;
+}                       t_server;
+
+typedef struct          s_client {
+    t_server            *server;
+    int                 fd;
+    t_dstr              output;
+    t_dstr              errors;
+}                       t_client;
+
+static ssize_t
+next_request (t_reader *reader, char **line) {
+
+    bool overlong = false;
+
+    while (true) {
+
+        char *eol = memchr(reader->buff + reader->start, '\n', reader->end - reader->start);
+
+        if (eol != NULL) {
+
+            *eol = '\0';
+            *line = reader->buff + reader->start;
+            reader->start = (size_t)(eol - reader->buff) + 1;
+            return overlong ? -2 : eol - *line;
+        }
+
+        /* Move what's left of the last request to the front, and drop requests that can't fit at all. */
+        memmove(reader->buff, reader->buff + reader->start, reader->end - reader->start);
+        reader->end -= reader->start;
+        reader->start = 0;
+        if (reader->end == sizeof(reader->buff)) {
+
+            overlong = true;
+            reader->end = 0;
+        }
+
+        const ssize_t size = read(reader->fd, reader->buff + reader->end, sizeof(reader->buff) - reader->end);
+
+        if (size == -1 && errno == EINTR) continue;
+        if (size <= 0) {
+
+            /* A last request without a newline is still a request. */
+            if (reader->end == 0 || overlong) return -1;
+            reader->buff[reader->end] = '\0';
+            *line = reader->buff;
+            reader->start = reader->end;
+            return (ssize_t)reader->end;
+        }
+
+        reader->end += (size_t)size;
+    }
+}
+
+static int
+split_request (char *line, const char **argv, int max) {
+
+    int     argc = 0;
+    char    *word = line;
+
+    /* Arguments are separated by blanks, a backslash escapes the character that follows it. */
+    while (*line != '\0') {
+
+        while (*line == ' ' || *line == '\t' || *line == '\r') line++;
+        if (*line == '\0') break;
+        if (argc == max) return -1;
+
+        argv[argc++] = word;
+        while (*line != '\0' && *line != ' ' && *line != '\t' && *line != '\r') {
+
+            if (*line == '\\' && line[1] != '\0') line++;
+            *word++ = *line++;
+        }
+
+        if (*line != '\0') line++;
+        *word++ = '\0';
+    }
+
+    return argc;
+}
+
+static const char **
+option (const t_opt *opts, const char *lname) {
+
+    /* The values of the options that main() reads itself are found through the table. */
+    for ( ; opts->type != FT_OPT_END; opts++)
+        if (opts->lname != NULL && ft_strequ(opts->lname, lname)) return (const char **)opts->ptr;
+
+    return NULL;
+}
+
+static int
+answer (t_client *client, char *request, ssize_t size) {
+
+    t_server    *server = client->server;
+    const char  *argv[ARGS_MAX + 1] = {server->meta->bin};
+    int         index = 1;
+    int         argc = size < 0 ? -1 : split_request(request, argv + 1, ARGS_MAX) + 1;
+    t_ofile     *ofile = server->ofile;
+    t_ofile     parsed;
+    t_match     *match = NULL;
+    const char  **jobs = option(server->opts, "jobs");
+    const char  **prefetch = option(server->opts, "prefetch");
+    const char  **address = option(server->opts, "serve");
+    unsigned    njobs = server->jobs;
+    bool        valid = false;
+    int         retcode = EXIT_FAILURE;
+
+    /*
+       Every request starts from the options the server was started with, its own patterns replace the server's. It
+       can pick its own --jobs, but files are never prefetched while the server keeps them mapped, a server doesn't
+       start another one, and files are only cached where the server was told to, never where a client names. The
+       options are parsed into the server's own, so one request at a time.
+    */
+
+    pthread_mutex_lock(&server->lock);
+    *ofile = server->base;
+    *jobs = *prefetch = *address = NULL;
+    if (argc <= 0 || (server->meta->obin == FT_NM && match_args(&argc, argv, &match) != EXIT_SUCCESS)
+        || ft_optparse(server->opts, &index, argc, (char **)argv) != 0) {
+
+        ft_dstrfpush(&client->errors, "%s: malformed request\n", server->meta->bin);
+    } else if (*prefetch != NULL || *address != NULL || ofile->cache != server->base.cache) {
+
+        ft_dstrfpush(&client->errors, "%s: --%s can't be given in a request\n", server->meta->bin,
+                *prefetch != NULL ? "prefetch" : *address != NULL ? "serve" : "cache");
+    } else if (*jobs != NULL && ft_atoi(*jobs) < 1) {
+
+        ft_dstrfpush(&client->errors, "%s: invalid number of jobs: \'%s\'\n", server->meta->bin, *jobs);
+    } else if (ofile->arch && ft_strequ(ofile->arch, "all") == 0 && NXGetArchInfoFromName(ofile->arch) == NULL) {
+
+        ft_dstrfpush(&client->errors, "%s: unknown architecture: \'%s\'\n", server->meta->bin, ofile->arch);
+    } else if (server->meta->obin == FT_OTOOL && (ofile->opt & (OTOOL_d | OTOOL_h | OTOOL_t)) == 0) {
+
+        ft_dstrfpush(&client->errors, "%s: one of -dht must be specified.\n", server->meta->bin);
+    } else if (index >= argc && ofile->tree == NULL) {
+
+        ft_dstrfpush(&client->errors, "%s: no file specified\n", server->meta->bin);
+    } else valid = true;
+
+    if (*jobs != NULL) njobs = (unsigned)ft_atoi(*jobs);
+    parsed = *ofile;
+    pthread_mutex_unlock(&server->lock);
+
+    if (valid) {
+
+        if (server->meta->obin == FT_NM && (argc - 1 > index || parsed.tree != NULL)) parsed.opt |= NAME_OUTPUT;
+        if (match != NULL) parsed.match = match;
+        parsed.output = &client->output;
+        parsed.errors = &client->errors;
+        parsed.maps = server->maps;
+        retcode = open_files(&parsed, server->meta, argv + index, (size_t)(argc - index), njobs);
+    }
+
+    match_del(match);
+    return retcode;
+}
+
+static int
+converse (t_client *client, int in, int out) {
+
+    t_reader    *reader = malloc(sizeof(t_reader));
+    t_dstr      header = {0};
+    char        *request;
+    ssize_t     size;
+
+    if (reader == NULL) return EXIT_FAILURE;
+
+    /*
+       Each request is a line holding the options and files, as they would be given on the command line. Each
+       response is a header line holding the exit status and the size of both outputs, followed by the outputs.
+    */
+
+    reader->fd = in;
+    reader->start = 0;
+    reader->end = 0;
+    while ((size = next_request(reader, &request)) != -1) {
+
+        if (client->output.buff != NULL) ft_dstrclr(&client->output);
+        if (client->errors.buff != NULL) ft_dstrclr(&client->errors);
+        if (header.buff != NULL) ft_dstrclr(&header);
+
+        const int       retcode = answer(client, request, size);
+        const size_t    outsize = client->output.buff ? ft_strlen(client->output.buff) : 0;
+        const size_t    errsize = client->errors.buff ? ft_strlen(client->errors.buff) : 0;
+
+        ft_dstrfpush(&header, "%d %lu %lu\n", retcode, (unsigned long)outsize, (unsigned long)errsize);
+        if (write_all(out, header.buff, ft_strlen(header.buff)) == EXIT_FAILURE
+            || write_all(out, client->output.buff, outsize) == EXIT_FAILURE
+            || write_all(out, client->errors.buff, errsize) == EXIT_FAILURE) break;
+    }
+
+    free(header.buff);
+    free(client->output.buff);
+    free(client->errors.buff);
+    free(reader);
+    return EXIT_SUCCESS;
+}
+
+static void *
+run_client (void *data) {
+
+    t_client *client = data;
+    t_server *server = client->server;
+
+    converse(client, client->fd, client->fd);
+    close(client->fd);
+    free(client);
+
+    /* The server waits for its last client before it lets go of the mappings they share. */
+    pthread_mutex_lock(&server->lock);
+    if (--server->clients == 0) pthread_cond_signal(&server->idle);
+    pthread_mutex_unlock(&server->lock);
+    return NULL;
+}
+
+static void
+accept_client (t_server *server, int fd) {
+
+    t_client    *client = malloc(sizeof(t_client));
+    pthread_t   thread;
+
+    if (client == NULL) {
+
+        ft_fprintf(stderr, "%s: %s\n", server->meta->bin, strerror(errno));
+        close(fd);
+        return;
+    }
+
+    /*
+       Each client is answered on a thread of its own, so an idle or slow one doesn't hold up the others. If no thread
+       can be started, it's answered on this one.
+    */
+
+    *client = (t_client){.server = server, .fd = fd};
+    pthread_mutex_lock(&server->lock);
+    server->clients++;
+    pthread_mutex_unlock(&server->lock);
+    if (pthread_create(&thread, NULL, run_client, client) != 0) run_client(client);
+    else pthread_detach(thread);
+}
+
+static int
+listen_on (const char *address) {
+
+    struct sockaddr_un  addr = {.sun_family = AF_UNIX};
+    struct stat         info;
+    const size_t        length = ft_strlen(address);
+
+    if (length >= sizeof(addr.sun_path)) return (errno = ENAMETOOLONG), -1;
+    ft_memcpy(addr.sun_path, address, length + 1);
+
+    /* A socket left behind by a previous server is replaced, anything else is left alone. */
+    if (lstat(address, &info) == 0 && S_ISSOCK(info.st_mode)) unlink(address);
+
+    const int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+
+    if (fd == -1) return -1;
+
+    /*
+       Whoever can connect gets any file the server can read dumped to them, so the socket is only open to the user
+       running the server. It's created that way rather than changed after, which would leave it open in between.
+    */
+
+    const mode_t    mask = umask(0177);
+    const int       bound = bind(fd, (struct sockaddr *)&addr, sizeof(addr));
+
+    umask(mask);
+    if (bound == -1 || listen(fd, SOMAXCONN) == -1) {
+
+        close(fd);
+        return -1;
+    }
+
+    return fd;
+}
+
+int
+serve (t_ofile *ofile, t_meta *meta, const t_opt *opts, const char *address, unsigned jobs) {
+
+    int         retcode = EXIT_SUCCESS;
+    t_server    server = {
+            .ofile = ofile,
+            .base = *ofile,
+            .meta = meta,
+            .opts = opts,
+            .maps = maps_new(),
+            .jobs = jobs
+    };
+
+    /*
+       Requests are answered in turn from stdin when the address is "-", or from clients of a UNIX socket, each client
+       on a thread of its own. Buffers are reused from one request to the next, and recently mapped files are kept
+       mapped.
+    */
+
+    if (server.maps == NULL || pthread_mutex_init(&server.lock, NULL) != 0) {
+
+        maps_del(server.maps);
+        return ft_fprintf(stderr, "%s: %s\n", meta->bin, strerror(errno)), EXIT_FAILURE;
+    }
+    if (pthread_cond_init(&server.idle, NULL) != 0) {
+
+        pthread_mutex_destroy(&server.lock);
+        maps_del(server.maps);
+        return ft_fprintf(stderr, "%s: %s\n", meta->bin, strerror(errno)), EXIT_FAILURE;
+    }
+    signal(SIGPIPE, SIG_IGN);
+
+    if (ft_strequ(address, "-")) {
+
+        t_client client = {.server = &server};
+
+        retcode = converse(&client, STDIN_FILENO, STDOUT_FILENO);
+    } else {
+
+        const int fd = listen_on(address);
+
+        if (fd == -1) {
+
+            ft_fprintf(stderr, "%s: %s: %s\n", meta->bin, address, strerror(errno));
+            retcode = EXIT_FAILURE;
+        }
+
+        while (fd != -1) {
+
+            const int client = accept(fd, NULL, NULL);
+
+            if (client == -1 && errno == EINTR) continue;
+            if (client == -1) {
+
+                ft_fprintf(stderr, "%s: %s: %s\n", meta->bin, address, strerror(errno));
+                retcode = EXIT_FAILURE;
+                close(fd);
+                break;
+            }
+
+            accept_client(&server, client);
+        }
+    }
+
+    pthread_mutex_lock(&server.lock);
+    while (server.clients > 0) pthread_cond_wait(&server.idle, &server.lock);
+    pthread_mutex_unlock(&server.lock);
+
+    pthread_cond_destroy(&server.idle);
+    pthread_mutex_destroy(&server.lock);
+    maps_del(server.maps);
+    return retcode;
+}
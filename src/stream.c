@@ -0,0 +1,662 @@
+#include "ofilep.h"
+#include <ar.h>
+#include <mach-o/fat.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#define STREAM_BLOCK (64UL << 10)
+#define PROBE_BLOCK (4UL << 10)
+#define SAR_EFMT1 3
+#ifndef MAP_NORESERVE
+# define MAP_NORESERVE 0
+#endif
+
+/*
+   Pipes can't be mapped, nor read twice. They are read once from start to end, keeping only windows of the bytes the
+   readers will look at: the headers, the load commands, the symbol and string tables, the headers and names of archive
+   members and the sections otool dumps. Windows are planned as the stream goes, from the ones before them, as where
+   the load commands are is only known once the header has been read, and where the tables are once the commands have.
+   A window planned for bytes the stream is already past is filled from the windows that kept them, and is broken if
+   none did, which fails the object it was planned for rather than leaving it zeros.
+
+   The readers ask for one object at a time: the whole input for a thin file, once it has ended, and each member of an
+   archive or slice of a fat file as soon as the stream is past its end. The windows in it are copied to their offsets
+   in a view, a mapping as large as the object whose other pages are never touched, and are freed along with the view
+   once the object has been dumped, so that memory stays within the tables of one object. A fat slice is one object, an
+   archive in it is kept until the slice has been read.
+
+   Probing a regular file plans the same windows, but reads each of them where it is with pread() rather than reading
+   the whole file through, so that otool -h on an object costs a read of its first page, and more only if its load
+   commands go past it.
+*/
+
+typedef struct          s_window {
+    uint64_t            start;
+    uint64_t            end;
+    uint64_t            limit;
+    uint64_t            origin;
+    char                *data;
+    uint64_t            held;
+    uint64_t            capacity;
+    bool                broken;
+    void                (*plan)(t_stream *, size_t);
+}                       t_window;
+
+typedef struct          s_view {
+    char                *data;
+    size_t              size;
+    uint64_t            start;
+    uint64_t            end;
+}                       t_view;
+
+struct                  s_stream {
+    const t_ofile       *ofile;
+    const t_meta        *meta;
+    t_window            *windows;
+    size_t              nwindows;
+    size_t              capacity;
+    t_view              *views;
+    size_t              nviews;
+    size_t              vcapacity;
+    t_view              *dropped;
+    size_t              ndropped;
+    size_t              dcapacity;
+    char                *file;
+    uint64_t            reserved;
+    char                *block;
+    uint64_t            bstart;
+    uint64_t            bend;
+    int                 fd;
+    int                 error;
+    bool                ended;
+    bool                failed;
+};
+
+static bool
+grow (void **array, size_t *capacity, size_t count, size_t size) {
+
+    void *grown;
+
+    if (count < *capacity) return true;
+    if ((grown = realloc(*array, (*capacity ? *capacity * 2 : 64) * size)) == NULL) return false;
+
+    *array = grown;
+    *capacity = *capacity ? *capacity * 2 : 64;
+    return true;
+}
+
+static void
+want (t_stream *stream, const t_window *from, uint64_t start, uint64_t length, void (*plan)(t_stream *, size_t)) {
+
+    /*
+       Windows never go past the slice or the member they are planned in, which also bounds corrupted lengths, and
+       belong to the object it starts at. A probe's windows are where they are in its mapping, a stream's are filled as
+       it goes.
+    */
+
+    uint64_t limit = from->limit;
+
+    if (stream->file != NULL && limit > stream->reserved) limit = stream->reserved;
+    if (start >= limit || length == 0 || stream->failed) return;
+    if (grow((void **)&stream->windows, &stream->capacity, stream->nwindows, sizeof(t_window)) == false)
+        return (void)(stream->failed = true);
+
+    stream->windows[stream->nwindows++] = (t_window){
+            .start = start,
+            .end = (length > limit - start) ? limit : start + length,
+            .limit = limit,
+            .origin = from->origin,
+            .data = stream->file != NULL ? stream->file + start : NULL,
+            .plan = plan
+    };
+}
+
+static void plan_start(t_stream *stream, uint64_t start, uint64_t limit);
+
+static size_t
+header_size (const t_window *window) {
+
+    const uint64_t  size = window->end - window->start;
+    uint32_t        magic = 0;
+
+    /* Windows stop at the end of their member or slice, which can be shorter than the header they were planned for. */
+    if (size >= sizeof magic) ft_memcpy(&magic, window->data, sizeof magic);
+    if (magic == MH_MAGIC_64 || magic == MH_CIGAM_64) return size >= sizeof(struct mach_header_64)
+            ? sizeof(struct mach_header_64) : 0;
+    return size >= sizeof(struct mach_header) ? sizeof(struct mach_header) : 0;
+}
+
+static void
+plan_commands (t_stream *stream, size_t k) {
+
+    if (header_size(&stream->windows[k]) == 0) return;
+
+    const t_window  window = stream->windows[k];
+    const char      *data = window.data;
+    const uint64_t  size = window.end - window.start;
+    const uint32_t  magic = *(const uint32_t *)data;
+    const bool      is_64 = magic == MH_MAGIC_64 || magic == MH_CIGAM_64;
+    const bool      is_cigam = magic == MH_CIGAM || magic == MH_CIGAM_64;
+    const uint32_t  ncmds = cswap_32(is_cigam, ((const struct mach_header *)data)->ncmds);
+    const size_t    nlist_size = is_64 ? sizeof(struct nlist_64) : sizeof(struct nlist);
+    const bool      nm = stream->meta->obin == FT_NM;
+    const uint32_t  opt = stream->ofile->opt;
+    size_t          offset = is_64 ? sizeof(struct mach_header_64) : sizeof(struct mach_header);
+
+    /* Walks the commands like the readers will, stopping at the first broken one as they do. */
+    for (uint32_t n = 0; n < ncmds && offset + sizeof(struct load_command) <= size; n++) {
+
+        const struct load_command   *command = (const struct load_command *)(data + offset);
+        struct load_command         header;
+
+        /* Broken files can put a command anywhere, its header is copied out rather than read in place. */
+        ft_memcpy(&header, command, sizeof header);
+
+        const uint32_t              cmd = cswap_32(is_cigam, header.cmd);
+        const uint32_t              cmdsize = cswap_32(is_cigam, header.cmdsize);
+
+        if (cmdsize < sizeof header || offset + cmdsize > size) break;
+        if (cmd == LC_SYMTAB && cmdsize >= sizeof(struct symtab_command)) {
+
+            const struct symtab_command *symtab = (const struct symtab_command *)command;
+
+            /* otool only checks the symbol table when it dumps sections. */
+            if (nm || opt & (OTOOL_d | OTOOL_t)) want(stream, &window, window.start + cswap_32(is_cigam,
+                    symtab->symoff), (uint64_t)cswap_32(is_cigam, symtab->nsyms) * nlist_size, NULL);
+            if (nm) want(stream, &window, window.start + cswap_32(is_cigam, symtab->stroff),
+                    cswap_32(is_cigam, symtab->strsize), NULL);
+        } else if (nm && opt & NM_EXPORTS && cmd == LC_DYLD_EXPORTS_TRIE
+            && cmdsize >= sizeof(struct linkedit_data_command)) {
+
+            const struct linkedit_data_command *trie = (const struct linkedit_data_command *)command;
+            want(stream, &window, window.start + cswap_32(is_cigam, trie->dataoff), cswap_32(is_cigam,
+                    trie->datasize), NULL);
+        } else if (nm && opt & NM_EXPORTS && (cmd == LC_DYLD_INFO || cmd == LC_DYLD_INFO_ONLY)
+            && cmdsize >= sizeof(struct dyld_info_command)) {
+
+            const struct dyld_info_command *info = (const struct dyld_info_command *)command;
+            want(stream, &window, window.start + cswap_32(is_cigam, info->export_off), cswap_32(is_cigam,
+                    info->export_size), NULL);
+        } else if (nm == false && cmd == (is_64 ? LC_SEGMENT_64 : LC_SEGMENT)) {
+
+            const size_t    segment_size = is_64 ? sizeof(struct segment_command_64) : sizeof(struct segment_command);
+            const size_t    section_size = is_64 ? sizeof(struct section_64) : sizeof(struct section);
+            uint32_t        nsects = 0;
+
+            if (cmdsize >= segment_size) nsects = cswap_32(is_cigam, is_64
+                    ? ((const struct segment_command_64 *)command)->nsects
+                    : ((const struct segment_command *)command)->nsects);
+
+            /* Only the sections otool dumps. */
+            for (uint32_t s = 0; s < nsects && offset + segment_size + (s + 1) * section_size <= size; s++) {
+
+                const char      *section = data + offset + segment_size + s * section_size;
+                const bool      text = ft_strnequ(section, SECT_TEXT, 16) && ft_strnequ(section + 16, SEG_TEXT, 16);
+                const bool      sdata = ft_strnequ(section, SECT_DATA, 16) && ft_strnequ(section + 16, SEG_DATA, 16);
+
+                if ((text == false || (opt & OTOOL_t) == 0) && (sdata == false || (opt & OTOOL_d) == 0)) continue;
+                if (is_64) want(stream, &window, window.start + cswap_32(is_cigam,
+                        ((const struct section_64 *)section)->offset), cswap_64(is_cigam,
+                        ((const struct section_64 *)section)->size), NULL);
+                else want(stream, &window, window.start + cswap_32(is_cigam, ((const struct section *)section)->offset),
+                        cswap_32(is_cigam, ((const struct section *)section)->size), NULL);
+            }
+        }
+
+        offset += cmdsize;
+    }
+}
+
+static void
+plan_header (t_stream *stream, size_t k) {
+
+    if (header_size(&stream->windows[k]) == 0) return;
+
+    const t_window  window = stream->windows[k];
+    const uint32_t  magic = *(const uint32_t *)window.data;
+    const bool      is_cigam = magic == MH_CIGAM || magic == MH_CIGAM_64;
+    const uint32_t  sizeofcmds = cswap_32(is_cigam, ((const struct mach_header *)window.data)->sizeofcmds);
+
+    want(stream, &window, window.start, window.end - window.start + sizeofcmds, plan_commands);
+}
+
+static void
+plan_fat (t_stream *stream, size_t k) {
+
+    const t_window  window = stream->windows[k];
+    const char      *data = window.data;
+    const uint32_t  magic = *(const uint32_t *)data;
+    const bool      is_64 = magic == FAT_MAGIC_64 || magic == FAT_CIGAM_64;
+    const bool      is_cigam = magic == FAT_CIGAM || magic == FAT_CIGAM_64;
+    const size_t    stride = is_64 ? sizeof(struct fat_arch_64) : sizeof(struct fat_arch);
+
+    /* Slice offsets are from the start of the fat file. */
+    for (size_t offset = sizeof(struct fat_header); offset + stride <= window.end - window.start; offset += stride) {
+
+        uint64_t start, size;
+
+        if (is_64) {
+
+            start = cswap_64(is_cigam, ((const struct fat_arch_64 *)(data + offset))->offset);
+            size = cswap_64(is_cigam, ((const struct fat_arch_64 *)(data + offset))->size);
+        } else {
+
+            start = cswap_32(is_cigam, ((const struct fat_arch *)(data + offset))->offset);
+            size = cswap_32(is_cigam, ((const struct fat_arch *)(data + offset))->size);
+        }
+
+        if (start < window.limit - window.start)
+            plan_start(stream, window.start + start, size > window.limit - window.start - start
+                    ? window.limit : window.start + start + size);
+    }
+}
+
+static bool
+member (t_stream *stream, const t_window *window, uint64_t *start, uint64_t *limit) {
+
+    /* A header cut short by the end of its slice is broken. */
+    if (window->end - window->start < sizeof(struct ar_hdr)) return false;
+
+    const struct ar_hdr *header = (const struct ar_hdr *)window->data;
+    const int           size = ft_atoi(header->ar_size);
+    const int           name = ft_strnequ(header->ar_name, AR_EFMT1, SAR_EFMT1)
+            ? ft_atoi(header->ar_name + SAR_EFMT1) : 0;
+
+    /*
+       Long names follow the header, and are part of the member's size. They are kept even when the header is broken,
+       as the error names the member. A broken header is where the readers stop.
+    */
+
+    *start = window->end;
+    *limit = (size >= 0 && (uint64_t)size < window->limit - *start) ? *start + (uint64_t)size : window->limit;
+    if (name > 0) want(stream, window, *start, (uint64_t)name, NULL);
+    if (ft_strnequ(ARFMAG, header->ar_fmag, 2) == 0 || size < 0 || name < 0) return false;
+
+    *start += (uint64_t)name;
+    return true;
+}
+
+static void
+plan_member (t_stream *stream, size_t k) {
+
+    const t_window  window = stream->windows[k];
+    uint64_t        start, limit;
+
+    if (member(stream, &window, &start, &limit) == false) return;
+
+    plan_start(stream, start, limit);
+    want(stream, &window, limit, sizeof(struct ar_hdr), plan_member);
+}
+
+static void
+plan_symdef (t_stream *stream, size_t k) {
+
+    const t_window  window = stream->windows[k];
+    uint64_t        start, limit;
+
+    /* The first member is the symbol table, which is only kept whole for --defines to look symbols up in it. */
+    if (member(stream, &window, &start, &limit) == false) return;
+
+    if (stream->ofile->defines != NULL) want(stream, &window, start, limit - start, NULL);
+    want(stream, &window, limit, sizeof(struct ar_hdr), plan_member);
+}
+
+static void
+plan_magic (t_stream *stream, size_t k) {
+
+    const t_window  window = stream->windows[k];
+    const char      *data = window.data;
+    const uint64_t  size = window.end - window.start;
+    uint32_t        magic = 0;
+
+    if (size >= sizeof magic) ft_memcpy(&magic, data, sizeof magic);
+
+    /*
+       Archives are walked member by member, fat files slice by slice, objects from their header on. Anything starting
+       with a zero word is taken for an archive, as dispatch() does.
+    */
+
+    if ((size >= SARMAG && ft_strnequ(data, ARMAG, SARMAG)) || (size >= sizeof magic && magic == 0))
+        want(stream, &window, window.start + SARMAG, sizeof(struct ar_hdr), plan_symdef);
+    else if (size >= sizeof(struct fat_header)
+        && (magic == FAT_MAGIC || magic == FAT_CIGAM || magic == FAT_MAGIC_64 || magic == FAT_CIGAM_64)) {
+
+        const bool      is_cigam = magic == FAT_CIGAM || magic == FAT_CIGAM_64;
+        const uint32_t  nfat_arch = cswap_32(is_cigam, ((const struct fat_header *)data)->nfat_arch);
+        const size_t    stride = (magic == FAT_MAGIC_64 || magic == FAT_CIGAM_64)
+                ? sizeof(struct fat_arch_64) : sizeof(struct fat_arch);
+
+        want(stream, &window, window.start, sizeof(struct fat_header) + (uint64_t)nfat_arch * stride, plan_fat);
+    } else if (magic == MH_MAGIC || magic == MH_CIGAM)
+        want(stream, &window, window.start, sizeof(struct mach_header), plan_header);
+    else if (magic == MH_MAGIC_64 || magic == MH_CIGAM_64)
+        want(stream, &window, window.start, sizeof(struct mach_header_64), plan_header);
+}
+
+static void
+plan_start (t_stream *stream, uint64_t start, uint64_t limit) {
+
+    const t_window object = {.limit = limit, .origin = start};
+
+    want(stream, &object, start, SARMAG, plan_magic);
+}
+
+static bool
+hold (t_window *window, uint64_t size) {
+
+    uint64_t    capacity = window->capacity ? window->capacity : PROBE_BLOCK;
+    char        *data;
+
+    /* Buffers grow with the bytes actually read, not with the length a header announces. */
+    if (size <= window->capacity) return true;
+    while (capacity < size) capacity *= 2;
+    if (capacity > window->end - window->start) capacity = window->end - window->start;
+    if ((data = realloc(window->data, (size_t)capacity)) == NULL) return false;
+
+    window->data = data;
+    window->capacity = capacity;
+    return true;
+}
+
+static const char *
+kept (const t_stream *stream, size_t k, uint64_t at, uint64_t *until) {
+
+    /* Bytes from before the current block are only still there if another window kept them. */
+    for (size_t j = 0; j < stream->nwindows; j++) {
+
+        const t_window *window = &stream->windows[j];
+
+        if (j == k || window->start > at || at >= window->start + window->held) continue;
+        if (window->start + window->held < *until) *until = window->start + window->held;
+        return window->data + (at - window->start);
+    }
+
+    return NULL;
+}
+
+static void
+feed (t_stream *stream, size_t k) {
+
+    t_window        *window = &stream->windows[k];
+    const uint64_t  end = window->end < stream->bend ? window->end : stream->bend;
+
+    /* Windows are copied from each block they overlap, and planned from once the stream is past their end. */
+    while (window->broken == false && window->start + window->held < end) {
+
+        const uint64_t  at = window->start + window->held;
+        uint64_t        until = end;
+        const char      *from = (at >= stream->bstart) ? stream->block + (at - stream->bstart)
+                : kept(stream, k, at, &until);
+
+        if (from == NULL) return (void)(window->broken = true);
+        if (hold(window, until - window->start) == false) return (void)(stream->failed = true);
+
+        ft_memcpy(window->data + window->held, from, (size_t)(until - at));
+        window->held = until - window->start;
+    }
+
+    if (window->broken == false && window->end <= stream->bend && window->plan != NULL) {
+
+        void (*plan)(t_stream *, size_t) = window->plan;
+
+        window->plan = NULL;
+        plan(stream, k);
+    }
+}
+
+static void
+pump (t_stream *stream, uint64_t until) {
+
+    /* Blocks are read until the stream is past the given offset, or the input ends. */
+    while (stream->ended == false && stream->failed == false && stream->bend < until) {
+
+        const ssize_t size = read(stream->fd, stream->block, STREAM_BLOCK);
+
+        if (size == -1 && errno == EINTR) continue;
+        if (size <= 0) {
+
+            stream->error = (size == -1) ? errno : 0;
+            stream->ended = true;
+            break;
+        }
+
+        stream->bstart = stream->bend;
+        stream->bend += (uint64_t)size;
+        for (size_t k = 0; k < stream->nwindows && stream->failed == false; k++) feed(stream, k);
+    }
+}
+
+uint64_t
+stream_reach (t_stream *stream, uint64_t end) {
+
+    /* How long a stream is, as far as it has to be read to tell whether it goes up to end. */
+    pump(stream, end);
+    return stream->bend;
+}
+
+size_t
+stream_read (t_stream *stream, uint64_t start, void *buff, size_t size) {
+
+    /* Copies what was kept of a range, zeros where nothing was. Returns how much of it the stream holds. */
+    pump(stream, start + size);
+    ft_memset(buff, 0, size);
+    for (size_t k = 0; k < stream->nwindows; k++) {
+
+        const t_window *window = &stream->windows[k];
+        const uint64_t held = window->start + window->held;
+        const uint64_t from = window->start > start ? window->start : start;
+        const uint64_t until = held < start + size ? held : start + size;
+
+        if (from < until) ft_memcpy((char *)buff + (from - start), window->data + (from - window->start),
+                (size_t)(until - from));
+    }
+
+    return stream->bend <= start ? 0 : (stream->bend - start < size) ? (size_t)(stream->bend - start) : size;
+}
+
+const void *
+stream_view (t_stream *stream, uint64_t start, uint64_t end, size_t *size) {
+
+    pump(stream, end);
+    if (stream->failed) return (errno = ENOMEM), NULL;
+    if (stream->bend < end && stream->error != 0) return (errno = stream->error), NULL;
+    if (end > stream->bend) end = stream->bend;
+    if (start > end) start = end;
+
+    /* Bytes dropped along with an earlier view can't be read again, and a broken window fails the object it's for. */
+    for (size_t k = 0; k < stream->ndropped; k++)
+        if (stream->dropped[k].start < end && start < stream->dropped[k].end) return (errno = ESPIPE), NULL;
+    for (size_t k = 0; k < stream->nwindows; k++)
+        if (stream->windows[k].broken && stream->windows[k].origin >= start && stream->windows[k].origin < end)
+            return (errno = ESPIPE), NULL;
+
+    if (grow((void **)&stream->views, &stream->vcapacity, stream->nviews, sizeof(t_view)) == false)
+        return (errno = ENOMEM), NULL;
+
+    /* Only the pages windows are copied to are ever touched. Even an empty view has a page, as the readers peek. */
+    const size_t    length = (end - start) ? (size_t)(end - start) : 1;
+    char            *data = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANON | MAP_NORESERVE, -1, 0);
+
+    if (data == MAP_FAILED) return NULL; /* E_RRNO */
+    for (size_t k = 0; k < stream->nwindows; k++) {
+
+        const t_window *window = &stream->windows[k];
+        const uint64_t from = window->start > start ? window->start : start;
+        const uint64_t until = window->start + window->held < end ? window->start + window->held : end;
+
+        if (from < until) ft_memcpy(data + (from - start), window->data + (from - window->start),
+                (size_t)(until - from));
+    }
+
+    stream->views[stream->nviews++] = (t_view){.data = data, .size = length, .start = start, .end = end};
+    *size = (size_t)(end - start);
+    return data;
+}
+
+static void
+release (t_stream *stream, uint64_t start, uint64_t end) {
+
+    size_t kept = 0;
+
+    /* The windows of a range are done with once it has been viewed. */
+    for (size_t k = 0; k < stream->nwindows; k++) {
+
+        if (stream->windows[k].start >= start && stream->windows[k].end <= end) free(stream->windows[k].data);
+        else stream->windows[kept++] = stream->windows[k];
+    }
+
+    stream->nwindows = kept;
+}
+
+void
+stream_drop (t_stream *stream, const void *view) {
+
+    size_t k = 0;
+
+    while (k < stream->nviews && stream->views[k].data != view) k++;
+    if (k == stream->nviews) return;
+
+    const t_view dropped = stream->views[k];
+
+    munmap(dropped.data, dropped.size);
+    stream->views[k] = stream->views[--stream->nviews];
+    release(stream, dropped.start, dropped.end);
+
+    /* Dropped ranges are remembered, merged with the one they follow or precede as archive members do. */
+    for (k = 0; k < stream->ndropped; k++) {
+
+        if (stream->dropped[k].end == dropped.start) return (void)(stream->dropped[k].end = dropped.end);
+        if (stream->dropped[k].start == dropped.end) return (void)(stream->dropped[k].start = dropped.start);
+    }
+
+    if (grow((void **)&stream->dropped, &stream->dcapacity, stream->ndropped, sizeof(t_view)) == false)
+        return (void)(stream->failed = true);
+    stream->dropped[stream->ndropped++] = (t_view){.start = dropped.start, .end = dropped.end};
+}
+
+void
+stream_del (t_stream *stream) {
+
+    if (stream == NULL) return;
+
+    for (size_t k = 0; k < stream->nviews; k++) munmap(stream->views[k].data, stream->views[k].size);
+    release(stream, 0, UINT64_MAX);
+    if (stream->fd != -1) close(stream->fd);
+
+    free(stream->windows);
+    free(stream->views);
+    free(stream->dropped);
+    free(stream->block);
+    free(stream);
+}
+
+int
+stream_file (t_ofile *ofile, t_meta *meta, int fd) {
+
+    t_stream    *stream = calloc(1, sizeof *stream);
+    char        head[SARMAG];
+    uint32_t    magic = 0;
+    uint64_t    end = UINT64_MAX;
+
+    /* The stream reads from its own descriptor, which outlives the one the path was opened with. */
+    ofile->file = NULL;
+    if (stream == NULL) return EXIT_FAILURE; /* E_RRNO */
+    stream->ofile = ofile;
+    stream->meta = meta;
+    stream->fd = dup(fd);
+    if (stream->fd == -1 || (stream->block = malloc(STREAM_BLOCK)) == NULL) {
+
+        stream_del(stream);
+        return EXIT_FAILURE; /* E_RRNO */
+    }
+
+    /*
+       Archives and fat files are handed over as their headers, and read on as their members and slices are asked for.
+       Anything else is handed over whole once the input has ended.
+    */
+
+    plan_start(stream, 0, UINT64_MAX);
+    const size_t size = stream_read(stream, 0, head, sizeof head);
+
+    if (size >= sizeof magic) ft_memcpy(&magic, head, sizeof magic);
+    if ((size >= SARMAG && ft_strnequ(head, ARMAG, SARMAG)) || (size >= sizeof magic && magic == 0)) end = size;
+    else if (size >= sizeof(struct fat_header)
+        && (magic == FAT_MAGIC || magic == FAT_CIGAM || magic == FAT_MAGIC_64 || magic == FAT_CIGAM_64))
+        end = sizeof(struct fat_header) + (uint64_t)cswap_32(magic == FAT_CIGAM || magic == FAT_CIGAM_64,
+                ((const struct fat_header *)head)->nfat_arch) * ((magic == FAT_MAGIC_64 || magic == FAT_CIGAM_64)
+                ? sizeof(struct fat_arch_64) : sizeof(struct fat_arch));
+
+    if ((ofile->file = stream_view(stream, 0, end, &ofile->size)) == NULL || ofile->size < sizeof(uint32_t)) {
+
+        const int saved = errno;
+
+        if (ofile->file != NULL) meta->errcode = E_GARBAGE;
+        ofile->file = NULL;
+        stream_del(stream);
+        errno = saved;
+        return EXIT_FAILURE; /* E_RRNO */
+    }
+
+    if (end == UINT64_MAX) release(stream, 0, UINT64_MAX);
+    ofile->stream = stream;
+    return EXIT_SUCCESS;
+}
+
+static bool
+fetch (t_stream *stream, int fd, uint64_t start, uint64_t end) {
+
+    /*
+       Reads go from the start of the page the window starts in, and are never shorter than a block, so that the windows
+       planned from a header mostly fall in the bytes read along with it. A file that got shorter leaves zeros.
+    */
+
+    start &= ~(uint64_t)(PROBE_BLOCK - 1);
+    if (end - start < PROBE_BLOCK) end = start + PROBE_BLOCK;
+    if (end > stream->reserved) end = stream->reserved;
+    stream->bstart = start;
+    stream->bend = end;
+
+    while (start < end) {
+
+        const ssize_t size = pread(fd, stream->file + start, (size_t)(end - start), (off_t)start);
+
+        if (size == -1 && errno == EINTR) continue;
+        if (size == -1) return false;
+        if (size == 0) break;
+        start += (uint64_t)size;
+    }
+
+    return true;
+}
+
+int
+probe_file (t_ofile *ofile, t_meta *meta, int fd) {
+
+    t_stream    stream = {.ofile = ofile, .meta = meta, .reserved = ofile->size, .fd = -1};
+    bool        failed = false;
+
+    /* Planning a window can append more, which are read in turn. */
+    ofile->file = NULL;
+    stream.file = mmap(NULL, ofile->size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANON | MAP_NORESERVE, -1, 0);
+    if (stream.file == MAP_FAILED) return EXIT_FAILURE; /* E_RRNO */
+
+    plan_start(&stream, 0, stream.reserved);
+    for (size_t k = 0; k < stream.nwindows && stream.failed == false && failed == false; k++) {
+
+        const t_window window = stream.windows[k];
+
+        if ((window.start < stream.bstart || window.end > stream.bend)
+            && fetch(&stream, fd, window.start, window.end) == false) failed = true;
+        else if (window.plan != NULL) window.plan(&stream, k);
+    }
+
+    free(stream.windows);
+    if (failed || stream.failed) {
+
+        munmap(stream.file, ofile->size);
+        return EXIT_FAILURE; /* E_RRNO */
+    }
+
+    ofile->file = stream.file;
+    return EXIT_SUCCESS;
+}
\ No newline at end of file
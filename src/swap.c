@@ -0,0 +1,74 @@
+#include "ofilep.h"
+#if defined(__x86_64__) || defined(__i386__)
+# include <tmmintrin.h>
+# define SWAP_SSSE3
+#endif
+
+/*
+   nm reads the symbol tables of byte-swapped objects once they're converted to the host's byte order, a block at a
+   time. The name index and the value are reversed, the description's two bytes swapped, the type and the section left
+   as they are. nlist_64 entries take a line each, nlist entries lay 4 to 3 lines, with their fields still 4-byte
+   aligned, so a line never splits one.
+*/
+
+static void
+swap_scalar (void *native, const void *nlists, size_t count, bool is_64) {
+
+    const size_t nlist_size = is_64 ? sizeof(struct nlist_64) : sizeof(struct nlist);
+
+    ft_memcpy(native, nlists, count * nlist_size);
+    for (char *entry = native; entry < (char *)native + count * nlist_size; entry += nlist_size) {
+
+        struct nlist_64 *nlist = (struct nlist_64 *)entry;
+
+        nlist->n_un.n_strx = __builtin_bswap32(nlist->n_un.n_strx);
+        nlist->n_desc = __builtin_bswap16(nlist->n_desc);
+        if (is_64) nlist->n_value = __builtin_bswap64(nlist->n_value);
+        else ((struct nlist *)entry)->n_value = __builtin_bswap32(((struct nlist *)entry)->n_value);
+    }
+}
+
+#ifdef SWAP_SSSE3
+
+/* Where each byte of a line is taken from. nlist entries repeat every 3 lines. */
+static const int8_t     shuffles[4][16] = {
+        { 3,  2,  1,  0,  4,  5,  7,  6, 15, 14, 13, 12, 11, 10,  9,  8},
+        { 3,  2,  1,  0,  4,  5,  7,  6, 11, 10,  9,  8, 15, 14, 13, 12},
+        { 0,  1,  3,  2,  7,  6,  5,  4, 11, 10,  9,  8, 12, 13, 15, 14},
+        { 3,  2,  1,  0,  7,  6,  5,  4,  8,  9, 11, 10, 15, 14, 13, 12}
+};
+
+__attribute__((target("ssse3")))
+static void
+swap_ssse3 (void *native, const void *nlists, size_t count, bool is_64) {
+
+    const __m128i   *in = nlists;
+    __m128i         *out = native;
+
+    const __m128i   first = _mm_loadu_si128((const __m128i *)shuffles[is_64 ? 0 : 1]);
+    const __m128i   second = _mm_loadu_si128((const __m128i *)shuffles[is_64 ? 0 : 2]);
+    const __m128i   third = _mm_loadu_si128((const __m128i *)shuffles[is_64 ? 0 : 3]);
+    const size_t    step = is_64 ? 3 : 4;
+    size_t          k = 0;
+
+    /* 3 lines at a time, 3 nlist_64 entries or 4 nlist ones. The last entries are swapped one at a time. */
+    for ( ; k + step <= count; k += step, in += 3, out += 3) {
+
+        _mm_storeu_si128(out, _mm_shuffle_epi8(_mm_loadu_si128(in), first));
+        _mm_storeu_si128(out + 1, _mm_shuffle_epi8(_mm_loadu_si128(in + 1), second));
+        _mm_storeu_si128(out + 2, _mm_shuffle_epi8(_mm_loadu_si128(in + 2), third));
+    }
+
+    if (k < count) swap_scalar(out, in, count - k, is_64);
+}
+
+#endif
+
+t_swap
+swap_kernel (void) {
+
+#ifdef SWAP_SSSE3
+    if (getenv("FT_NM_SCALAR") == NULL && __builtin_cpu_supports("ssse3")) return swap_ssse3;
+#endif
+    return swap_scalar;
+}
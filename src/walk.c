@@ -0,0 +1,159 @@
+#include "ofilep.h"
+#include <ar.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+void
+paths_del (t_paths *paths) {
+
+    for (size_t k = 0; k < paths->npaths; k++) free(paths->paths[k]);
+    free(paths->paths);
+    *paths = (t_paths){0};
+}
+
+static int
+push_path (t_paths *paths, char *path) {
+
+    if (path == NULL) return EXIT_FAILURE;
+    if (paths->npaths == paths->capacity) {
+
+        const size_t    capacity = paths->capacity ? paths->capacity * 2 : 256;
+        char            **grown = realloc(paths->paths, capacity * sizeof *grown);
+
+        if (grown == NULL) {
+
+            free(path);
+            return EXIT_FAILURE;
+        }
+
+        paths->paths = grown;
+        paths->capacity = capacity;
+    }
+
+    paths->paths[paths->npaths++] = path;
+    return EXIT_SUCCESS;
+}
+
+static char *
+join (const char *dir, const char *name) {
+
+    const size_t    dirlen = ft_strlen(dir);
+    const size_t    namelen = ft_strlen(name);
+    const bool      slash = dirlen > 0 && dir[dirlen - 1] != '/';
+    char            *path = malloc(dirlen + slash + namelen + 1);
+
+    if (path == NULL) return NULL;
+    ft_memcpy(path, dir, dirlen);
+    if (slash) path[dirlen] = '/';
+    ft_memcpy(path + dirlen + slash, name, namelen + 1);
+    return path;
+}
+
+static int
+name_cmp (const void *a, const void *b) {
+
+    return ft_strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+static bool
+has_magic (int dir, const char *name) {
+
+    char        head[SARMAG];
+    const int   fd = openat(dir, name, O_RDONLY);
+
+    /* A file we can't read is kept, so that the reason is reported when it's opened. */
+    if (fd == -1) return true;
+
+    const ssize_t size = read(fd, head, sizeof head);
+
+    close(fd);
+    return size >= 0 && is_object(head, (size_t)size);
+}
+
+static int
+report (const t_ofile *ofile, const t_meta *meta, const char *path) {
+
+    if (ofile->output != NULL) ft_dstrfpush(ofile->errors, "%s: \'%s\': %s\n", meta->bin, path, strerror(errno));
+    else ft_fprintf(stderr, "%s: \'%s\': %s\n", meta->bin, path, strerror(errno));
+    return EXIT_FAILURE;
+}
+
+static int
+walk_dir (const t_ofile *ofile, const t_meta *meta, const char *dir, t_paths *paths, t_paths *dirs) {
+
+    DIR             *stream = opendir(dir);
+    struct dirent   *dirent;
+    t_paths         names = {0};
+    const size_t    first = dirs->npaths;
+    int             retcode = EXIT_SUCCESS;
+
+    if (stream == NULL) return report(ofile, meta, dir);
+
+    /* Entries are taken in name order, so the output doesn't depend on the order the file system keeps them in. */
+    while ((dirent = readdir(stream)) != NULL) {
+
+        if (ft_strequ(dirent->d_name, ".") || ft_strequ(dirent->d_name, "..")) continue;
+        if (push_path(&names, ft_strdup(dirent->d_name)) != EXIT_SUCCESS) {
+
+            retcode = report(ofile, meta, dir);
+            break;
+        }
+    }
+
+    qsort(names.paths, names.npaths, sizeof *names.paths, name_cmp);
+
+    /*
+       Files that don't start with a magic number dispatch() knows are left out without being mapped. Links are
+       followed to files, but not to directories, which could lead back up the tree.
+    */
+
+    for (size_t k = 0; retcode == EXIT_SUCCESS && k < names.npaths; k++) {
+
+        struct stat info;
+        const char  *name = names.paths[k];
+
+        if (fstatat(dirfd(stream), name, &info, AT_SYMLINK_NOFOLLOW) == -1) continue;
+        if (S_ISDIR(info.st_mode)) {
+
+            if (push_path(dirs, join(dir, name)) != EXIT_SUCCESS) retcode = report(ofile, meta, dir);
+        } else if ((S_ISREG(info.st_mode) || (S_ISLNK(info.st_mode) && fstatat(dirfd(stream), name, &info, 0) == 0
+            && S_ISREG(info.st_mode))) && has_magic(dirfd(stream), name)) {
+
+            if (push_path(paths, join(dir, name)) != EXIT_SUCCESS) retcode = report(ofile, meta, dir);
+        }
+    }
+
+    /* Directories are walked after the files next to them, in order, so they go on the stack last one first. */
+    for (size_t left = first, right = dirs->npaths; left + 1 < right; left++, right--) {
+
+        char *swap = dirs->paths[left];
+        dirs->paths[left] = dirs->paths[right - 1];
+        dirs->paths[right - 1] = swap;
+    }
+
+    paths_del(&names);
+    closedir(stream);
+    return retcode;
+}
+
+int
+walk_tree (const t_ofile *ofile, const t_meta *meta, const char *root, t_paths *paths) {
+
+    t_paths dirs = {0};
+    int     retcode = EXIT_SUCCESS;
+
+    /* Directories are walked depth first with a stack of the ones left to walk, rather than by recursion. */
+    if (push_path(&dirs, ft_strdup(root)) != EXIT_SUCCESS) return report(ofile, meta, root);
+    while (dirs.npaths > 0) {
+
+        char *dir = dirs.paths[--dirs.npaths];
+
+        if (walk_dir(ofile, meta, dir, paths, &dirs) != EXIT_SUCCESS) retcode = EXIT_FAILURE;
+        free(dir);
+    }
+
+    paths_del(&dirs);
+    return retcode;
+}
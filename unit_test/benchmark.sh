@@ -0,0 +1,327 @@
+#!/bin/zsh
+# Usage: ./benchmark.sh [reference ft_nm [reference ft_otool]]
+# Times ../ft_nm (and optionally a reference build, e.g. from an older commit) on synthetic inputs.
+REF=$1
+REF_OTOOL=$2
+TMP=$(mktemp -d)
+trap "rm -rf $TMP" EXIT
+zmodload zsh/datetime
+
+echo "\x1b[33;1mnm symbol sort scaling\x1b[0m";
+for nsyms in 10000 100000 1000000;
+do;
+	./gen_symtab.py $nsyms $TMP/sym_$nsyms;
+	for opt in "" "-n" "-r";
+	do;
+		printf "%-8s %-3s ft_nm: " $nsyms "$opt";
+		( time ../ft_nm $=opt $TMP/sym_$nsyms > /dev/null ) 2>&1 | tail -1;
+		if [[ -n $REF ]]
+		then
+			printf "%-8s %-3s ref:   " $nsyms "$opt";
+			( time $REF $=opt $TMP/sym_$nsyms > /dev/null ) 2>&1 | tail -1;
+		fi
+	done;
+done;
+
+echo "\x1b[33;1mnm/otool many files, --jobs\x1b[0m";
+FILES=(./valid_binaries/*/*(.) ./valid_binaries/*/*(.) ./valid_binaries/*/*(.) ./valid_binaries/*/*(.))
+for jobs in 1 2 4 8;
+do;
+	printf "%-2s jobs ft_nm:    " $jobs;
+	( time ../ft_nm --jobs $jobs --arch all $FILES > /dev/null 2>&1 ) 2>&1 | tail -1;
+	printf "%-2s jobs ft_otool: " $jobs;
+	( time ../ft_otool -j $jobs -t --arch all $FILES > /dev/null 2>&1 ) 2>&1 | tail -1;
+done;
+
+echo "\x1b[33;1mfat slices, --arch all, --jobs\x1b[0m";
+for file in ./valid_binaries/fat/*(.);
+do;
+	for jobs in 1 4;
+	do;
+		printf "%-2s jobs %-50s " $jobs $file;
+		( time ../ft_nm --jobs $jobs --arch all $file > /dev/null 2>&1 ) 2>&1 | tail -1;
+	done;
+done;
+
+echo "\x1b[33;1marchive members, --jobs\x1b[0m";
+mkdir -p $TMP/members;
+for k in {1..5000}; do; ./gen_symtab.py 200 $TMP/members/m$k.o; done;
+ar -rcs $TMP/big.a $TMP/members/*.o 2> /dev/null;
+for jobs in 1 2 4 8;
+do;
+	printf "%-2s jobs ft_nm:    " $jobs;
+	( time ../ft_nm --jobs $jobs $TMP/big.a > /dev/null 2>&1 ) 2>&1 | tail -1;
+done;
+
+echo "\x1b[33;1msymbol lookup in archives, --defines\x1b[0m";
+for nmembers in 500 5000;
+do;
+	ar -rcs $TMP/lookup_$nmembers.a $TMP/members/m{1..$nmembers}.o 2> /dev/null;
+	symbol=$(../ft_nm $TMP/members/m1.o | awk '$2 == "T" { print $3; exit }');
+	printf "%-5s members, full dump: " $nmembers;
+	( time ../ft_nm $TMP/lookup_$nmembers.a > /dev/null 2>&1 ) 2>&1 | tail -1;
+	printf "%-5s members, --defines: " $nmembers;
+	( time ../ft_nm --defines $symbol $TMP/lookup_$nmembers.a > /dev/null 2>&1 ) 2>&1 | tail -1;
+done;
+
+echo "\x1b[33;1mbatch server, --serve vs one process per file\x1b[0m";
+for k in {1..2000}; do; echo "-g $TMP/members/m$(( k % 500 + 1 )).o"; done > $TMP/requests;
+printf "fork/exec per file: ";
+( time (while read -r request; do; ../ft_nm $=request; done < $TMP/requests > /dev/null 2>&1) ) 2>&1 | tail -1;
+printf "--serve -:          ";
+( time ../ft_nm --serve - < $TMP/requests > /dev/null 2>&1 ) 2>&1 | tail -1;
+../ft_nm --serve $TMP/nm.sock & SERVER=$!;
+sleep 0.5;
+printf "--serve socket:     ";
+( time ./serve_client.py $TMP/nm.sock < $TMP/requests > /dev/null 2>&1 ) 2>&1 | tail -1;
+kill $SERVER;
+
+echo "\x1b[33;1mresult cache, --cache cold vs warm\x1b[0m";
+sleep 2;
+for opt in "" "--jobs 4";
+do;
+	printf "%-8s no cache: " "$opt";
+	( time ../ft_nm $=opt $TMP/members/*.o > /dev/null 2>&1 ) 2>&1 | tail -1;
+	rm -rf $TMP/cache;
+	printf "%-8s cold:     " "$opt";
+	( time ../ft_nm $=opt --cache $TMP/cache $TMP/members/*.o > /dev/null 2>&1 ) 2>&1 | tail -1;
+	printf "%-8s warm:     " "$opt";
+	( time ../ft_nm $=opt --cache $TMP/cache $TMP/members/*.o > /dev/null 2>&1 ) 2>&1 | tail -1;
+done;
+
+echo "\x1b[33;1motool -t hexdump throughput, SIMD vs scalar\x1b[0m";
+for arch in x86_64 arm64 ppc;
+do;
+	./gen_text.py 40000000 $arch $TMP/text_$arch;
+	for mode in simd scalar;
+	do;
+		start=$EPOCHREALTIME;
+		if [[ $mode == scalar ]]; then; FT_OTOOL_SCALAR=1 ../ft_otool -t $TMP/text_$arch > /dev/null;
+		else; ../ft_otool -t $TMP/text_$arch > /dev/null; fi;
+		printf "%-6s %-6s %8.1f MB/s\n" $arch $mode $(( 40.0 / (EPOCHREALTIME - start) ));
+		if [[ -n $REF_OTOOL ]]
+		then
+			start=$EPOCHREALTIME;
+			if [[ $mode == scalar ]]; then; FT_OTOOL_SCALAR=1 $REF_OTOOL -t $TMP/text_$arch > /dev/null;
+			else; $REF_OTOOL -t $TMP/text_$arch > /dev/null; fi;
+			printf "%-6s %-6s %8.1f MB/s ref\n" $arch $mode $(( 40.0 / (EPOCHREALTIME - start) ));
+		fi
+	done;
+done;
+
+echo "\x1b[33;1mnm line output, symbol-heavy dylibs\x1b[0m";
+lines=$(../ft_nm --arch all ./valid_binaries/fat_lib/*(.) 2> /dev/null | wc -l);
+for opt in "" "-j" "-a";
+do;
+	start=$EPOCHREALTIME;
+	for k in {1..20}; do; ../ft_nm $=opt --arch all ./valid_binaries/fat_lib/*(.) > /dev/null 2>&1; done;
+	printf "%-3s ft_nm: %10.0f lines/s\n" "$opt" $(( 20.0 * lines / (EPOCHREALTIME - start) ));
+	if [[ -n $REF ]]
+	then
+		start=$EPOCHREALTIME;
+		for k in {1..20}; do; $REF $=opt --arch all ./valid_binaries/fat_lib/*(.) > /dev/null 2>&1; done;
+		printf "%-3s ref:   %10.0f lines/s\n" "$opt" $(( 20.0 * lines / (EPOCHREALTIME - start) ));
+	fi
+done;
+
+echo "\x1b[33;1msymbol table parsing per width and byte order, SIMD vs scalar swap\x1b[0m";
+for arch in x86_64 i386 ppc64 ppc;
+do;
+	./gen_symtab.py 2000000 $TMP/variant_$arch $arch;
+	printf "%-7s ft_nm:        " $arch;
+	( time ../ft_nm -p --defines _none $TMP/variant_$arch > /dev/null 2>&1 ) 2>&1 | tail -1;
+	printf "%-7s ft_nm scalar: " $arch;
+	( time FT_NM_SCALAR=1 ../ft_nm -p --defines _none $TMP/variant_$arch > /dev/null 2>&1 ) 2>&1 | tail -1;
+	if [[ -n $REF ]]
+	then
+		printf "%-7s ref:          " $arch;
+		( time $REF -p --defines _none $TMP/variant_$arch > /dev/null 2>&1 ) 2>&1 | tail -1;
+	fi
+done;
+
+echo "\x1b[33;1marchive members, peak memory\x1b[0m";
+TIMEFMT="%*E s, %M KB max RSS";
+for jobs in 1 4;
+do;
+	printf "%-2s jobs ft_nm: " $jobs;
+	( time ../ft_nm --jobs $jobs $TMP/big.a > /dev/null 2>&1 ) 2>&1 | tail -1;
+	if [[ -n $REF ]]
+	then
+		printf "%-2s jobs ref:   " $jobs;
+		( time $REF --jobs $jobs $TMP/big.a > /dev/null 2>&1 ) 2>&1 | tail -1;
+	fi
+done;
+unset TIMEFMT;
+
+echo "\x1b[33;1motool -t peak memory per section size\x1b[0m";
+TIMEFMT="%*E s, %M KB max RSS";
+for size in 4 16 64;
+do;
+	./gen_text.py $((size << 20)) x86_64 $TMP/stream_$size;
+	printf "%-3s MB ft_otool: " $size;
+	( time ../ft_otool -t $TMP/stream_$size > /dev/null 2>&1 ) 2>&1 | tail -1;
+	if [[ -n $REF ]]
+	then
+		printf "%-3s MB ref:      " $size;
+		( time $REF -t $TMP/stream_$size > /dev/null 2>&1 ) 2>&1 | tail -1;
+	fi
+done;
+unset TIMEFMT;
+
+echo "\x1b[33;1mnm -g/-u/-U on a dylib laid out by LC_DYSYMTAB\x1b[0m";
+./gen_symtab.py 2000000 $TMP/dylib x86_64 dylib;
+for opt in "-gp" "-up" "-Up" "-g";
+do;
+	printf "%-3s ft_nm: " $opt;
+	( time ../ft_nm $opt $TMP/dylib > /dev/null ) 2>&1 | tail -1;
+	if [[ -n $REF ]]
+	then
+		printf "%-3s ref:   " $opt;
+		( time $REF $opt $TMP/dylib > /dev/null ) 2>&1 | tail -1;
+	fi
+done;
+
+echo "\x1b[33;1mnm --exports against -gU on the fat_lib dylibs\x1b[0m";
+for opt in "--exports" "-gU";
+do;
+	printf "%-9s ft_nm: " $opt;
+	( time (for k in {1..20}; do ../ft_nm $opt valid_binaries/fat_lib/*.dylib > /dev/null; done) ) 2>&1 | tail -1;
+done;
+
+echo "\x1b[33;1mnm sort scaling on a single large symbol table\x1b[0m";
+./gen_symtab.py 4000000 $TMP/scaling;
+for opt in "-j" "-nj";
+do;
+	for jobs in 1 2 4 8 16 32;
+	do;
+		printf "%-3s %-2s jobs ft_nm: " $opt $jobs;
+		( time ../ft_nm $opt --jobs $jobs $TMP/scaling > /dev/null ) 2>&1 | tail -1;
+	done;
+done;
+
+echo "\x1b[33;1mnm -R against find | xargs on a tree mixing objects and other files\x1b[0m";
+rm -rf $TMP/tree;
+for k in {1..16};
+do;
+	mkdir -p $TMP/tree/$k/src;
+	cp -R valid_binaries $TMP/tree/$k/;
+	cp *.sh *.py $TMP/tree/$k/src/;
+done;
+cp $TMP/dylib $TMP/tree/1/;
+printf "find | xargs:       ";
+( time (find $TMP/tree -type f | xargs ../ft_nm > /dev/null 2>&1) ) 2>&1 | tail -1;
+for jobs in 1 4 8;
+do;
+	printf "%-2s jobs ft_nm -R: " $jobs;
+	( time ../ft_nm --jobs $jobs -R $TMP/tree > /dev/null 2>&1 ) 2>&1 | tail -1;
+done;
+
+echo "\x1b[33;1mnm --match against nm | grep on a large symbol table\x1b[0m";
+patterns=("__ZN3ns1" "__ZN?ns1*E*func3Ev");
+regexes=(" __ZN3ns1" " __ZN.ns1.*E.*func3Ev\$");
+for k in 1 2;
+do;
+	printf "%-20s grep:    " $patterns[$k];
+	( time (../ft_nm $TMP/scaling | grep -E $regexes[$k] > /dev/null) ) 2>&1 | tail -1;
+	printf "%-20s --match: " $patterns[$k];
+	( time ../ft_nm --match $patterns[$k] $TMP/scaling > /dev/null ) 2>&1 | tail -1;
+done;
+
+echo "\x1b[33;1motool -t throughput on a 200 MB __text section by thread count\x1b[0m";
+for arch in x86_64 ppc;
+do;
+	./gen_text.py $((200 << 20)) $arch $TMP/large_$arch;
+	for jobs in 1 2 4 8 16;
+	do;
+		start=$EPOCHREALTIME;
+		../ft_otool --jobs $jobs -t $TMP/large_$arch > /dev/null;
+		printf "%-6s %-2s jobs %8.1f MB/s\n" $arch $jobs $(( 200.0 / (EPOCHREALTIME - start) ));
+	done;
+done;
+
+echo "\x1b[33;1mnm on 4000 objects from a cold page cache by prefetch depth\x1b[0m";
+mkdir -p $TMP/cold;
+for k in {1..8};
+do;
+	./gen_symtab.py $((k * 1000)) $TMP/cold/seed_$k.o;
+done;
+for k in {1..4000};
+do;
+	cp $TMP/cold/seed_$((k % 8 + 1)).o $TMP/cold/$k.o;
+done;
+for jobs in 1 4;
+do;
+	for depth in 0 1 8 32;
+	do;
+		# Dropping the page cache needs root, without it the files are warm after the first run.
+		sync;
+		[[ -w /proc/sys/vm/drop_caches ]] && echo 3 > /proc/sys/vm/drop_caches;
+		printf "%-2s jobs prefetch %-2s: " $jobs $depth;
+		( time ../ft_nm --jobs $jobs --prefetch $depth $TMP/cold/*.o > /dev/null ) 2>&1 | tail -1;
+	done;
+done;
+
+echo "\x1b[33;1mcounting symbols through libofile against running nm and parsing its output\x1b[0m";
+if [[ -f ../libofile.a ]];
+then;
+	gcc -O2 -I ../libft/include ofile_client.c ../libofile.a -L ../libft -lft -lpthread -o $TMP/ofile_client;
+	for k in {1..200};
+	do;
+		cp $TMP/cold/seed_$((k % 8 + 1)).o $TMP/client_$k.o;
+	done;
+	printf "200 objects  exec: ";
+	( time $TMP/ofile_client exec ../ft_nm $TMP/client_*.o > /dev/null ) 2>&1 | tail -1;
+	printf "200 objects  lib:  ";
+	( time $TMP/ofile_client lib $TMP/client_*.o > /dev/null ) 2>&1 | tail -1;
+	printf "large table  exec: ";
+	( time $TMP/ofile_client exec ../ft_nm $TMP/scaling > /dev/null ) 2>&1 | tail -1;
+	printf "large table  lib:  ";
+	( time $TMP/ofile_client lib $TMP/scaling > /dev/null ) 2>&1 | tail -1;
+fi;
+
+echo "\x1b[33;1mreading from a pipe against mapping the file\x1b[0m";
+TIMEFMT="%*E s, %M KB max RSS";
+printf "archive     file:  ";
+( time ../ft_nm $TMP/big.a > /dev/null 2>&1 ) 2>&1 | tail -1;
+printf "archive     stdin: ";
+( time ../ft_nm - < $TMP/big.a > /dev/null 2>&1 ) 2>&1 | tail -1;
+printf "archive     pipe:  ";
+( time ( cat $TMP/big.a | ../ft_nm - > /dev/null 2>&1 ) ) 2>&1 | tail -1;
+for bin in "ft_nm" "ft_otool -t";
+do;
+	printf "%-11s file:  " $bin;
+	( time ../${=bin} $TMP/stream_64 > /dev/null 2>&1 ) 2>&1 | tail -1;
+	printf "%-11s pipe:  " $bin;
+	( time ( cat $TMP/stream_64 | ../${=bin} - > /dev/null 2>&1 ) ) 2>&1 | tail -1;
+done;
+unset TIMEFMT;
+
+echo "\x1b[33;1motool -h against --probe on 4000 objects, cold and warm\x1b[0m";
+for opt in "-h" "--probe";
+do;
+	sync;
+	[[ -w /proc/sys/vm/drop_caches ]] && echo 3 > /proc/sys/vm/drop_caches;
+	printf "%-7s cold: " $opt;
+	( time ../ft_otool $opt $TMP/cold/*.o > /dev/null ) 2>&1 | tail -1;
+	printf "%-7s warm: " $opt;
+	( time ../ft_otool $opt $TMP/cold/*.o > /dev/null ) 2>&1 | tail -1;
+done;
+
+echo "\x1b[33;1m--dedup on an archive holding each member 8 times\x1b[0m";
+rm -rf $TMP/umbrella && mkdir -p $TMP/umbrella;
+for k in {1..64};
+do;
+	cp $TMP/cold/seed_$((k % 8 + 1)).o $TMP/umbrella/member_$k.o;
+done;
+ar -rcs $TMP/umbrella.a $TMP/umbrella/*.o 2> /dev/null;
+for bin in "ft_nm" "ft_otool -t";
+do;
+	for jobs in 1 4;
+	do;
+		printf "%-11s %s jobs:         " $bin $jobs;
+		( time ../${=bin} --jobs $jobs $TMP/umbrella.a > /dev/null ) 2>&1 | tail -1;
+		printf "%-11s %s jobs --dedup: " $bin $jobs;
+		( time ../${=bin} --jobs $jobs --dedup $TMP/umbrella.a > /dev/null 2>&1 ) 2>&1 | tail -1;
+	done;
+done;
+../ft_nm --dedup $TMP/umbrella.a 2>&1 > /dev/null | tail -1;
@@ -0,0 +1,71 @@
+#!/usr/bin/env python3
+"""Generate a synthetic Mach-O object with a given number of symbols, for benchmarking."""
+
+import random
+import struct
+import sys
+
+MH_MAGIC, MH_MAGIC_64, MH_OBJECT, MH_DYLIB = 0xfeedface, 0xfeedfacf, 0x1, 0x6
+LC_SEGMENT, LC_SEGMENT_64, LC_SYMTAB, LC_DYSYMTAB = 0x1, 0x19, 0x2, 0xb
+N_SECT, N_UNDF, N_EXT = 0xe, 0x0, 0x1
+
+# cputype, 64-bit, byte order: one architecture for each width and byte order.
+ARCHS = {
+    "x86_64": (0x01000007, True, "<"),
+    "i386": (0x7, False, "<"),
+    "ppc64": (0x01000012, True, ">"),
+    "ppc": (0x12, False, ">"),
+}
+
+
+def main():
+    if (len(sys.argv) not in (3, 4, 5) or (len(sys.argv) >= 4 and sys.argv[3] not in ARCHS)
+            or (len(sys.argv) == 5 and sys.argv[4] != "dylib")):
+        sys.exit("usage: gen_symtab.py NSYMS OUTPUT [x86_64|i386|ppc64|ppc [dylib]]")
+
+    nsyms, path = int(sys.argv[1]), sys.argv[2]
+    cputype, is_64, order = ARCHS[sys.argv[3] if len(sys.argv) >= 4 else "x86_64"]
+    dylib = len(sys.argv) == 5
+    rng = random.Random(nsyms)
+
+    # C++-like names sharing long common prefixes, with duplicates to exercise the value tie-break.
+    strtab = bytearray(b"\0")
+    symbols = []
+    for k in range(nsyms):
+        name = "__ZN%dns%dE%dfunc%dEv" % (rng.randrange(8), rng.randrange(64), rng.randrange(nsyms), k % 7)
+        if dylib:
+            # Mostly local symbols, laid out local, external defined then undefined, as ld does for LC_DYSYMTAB.
+            n_type = N_SECT if k < nsyms * 8 // 10 else N_SECT | N_EXT if k < nsyms * 9 // 10 else N_UNDF | N_EXT
+        else:
+            n_type = N_UNDF | N_EXT if k % 5 == 0 else N_SECT | (N_EXT if k % 2 else 0)
+        n_sect, n_value = (0, 0) if n_type & 0xe == N_UNDF else (1, rng.randrange(1 << 20) * 16)
+        symbols.append(struct.pack(order + ("IBBHQ" if is_64 else "IBBHI"), len(strtab), n_type, n_sect, 0, n_value))
+        strtab += name.encode() + b"\0"
+
+    ncmds, filetype, extra = (3, MH_DYLIB, 80) if dylib else (2, MH_OBJECT, 0)
+    if is_64:
+        sizeofcmds = 72 + 80 + 24 + extra
+        symoff = 32 + sizeofcmds
+        stroff = symoff + 16 * nsyms
+        header = struct.pack(order + "IiiIIII4x", MH_MAGIC_64, cputype, 3, filetype, ncmds, sizeofcmds, 0)
+        segment = struct.pack(order + "II16sQQQQiiII", LC_SEGMENT_64, 72 + 80, b"", 0, 0, 0, 0, 7, 7, 1, 0)
+        section = struct.pack(order + "16s16sQQIIIIIIII", b"__text", b"__TEXT", 0, 0, 0, 0, 0, 0, 0, 0, 0, 0)
+    else:
+        sizeofcmds = 56 + 68 + 24 + extra
+        symoff = 28 + sizeofcmds
+        stroff = symoff + 12 * nsyms
+        header = struct.pack(order + "IiiIIII", MH_MAGIC, cputype, 3, filetype, ncmds, sizeofcmds, 0)
+        segment = struct.pack(order + "II16sIIIIiiII", LC_SEGMENT, 56 + 68, b"", 0, 0, 0, 0, 7, 7, 1, 0)
+        section = struct.pack(order + "16s16sIIIIIIIII", b"__text", b"__TEXT", 0, 0, 0, 0, 0, 0, 0, 0, 0)
+    symtab = struct.pack(order + "IIIIII", LC_SYMTAB, 24, symoff, nsyms, stroff, len(strtab))
+    if dylib:
+        nlocal, nextdef = nsyms * 8 // 10, nsyms * 9 // 10 - nsyms * 8 // 10
+        symtab += struct.pack(order + "20I", LC_DYSYMTAB, 80, 0, nlocal, nlocal, nextdef, nlocal + nextdef,
+                              nsyms - nlocal - nextdef, *([0] * 12))
+
+    with open(path, "wb") as out:
+        out.write(header + segment + section + symtab + b"".join(symbols) + strtab)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,42 @@
+#!/usr/bin/env python3
+"""Generate a synthetic Mach-O object with a __TEXT,__text section of a given size, for benchmarking otool -t."""
+
+import random
+import struct
+import sys
+
+# cputype, 64-bit, byte order: x86 is dumped byte by byte, the others word by word, ppc in swapped byte order.
+ARCHS = {
+    "x86_64": (0x01000007, True, "<"),
+    "arm64": (0x0100000c, True, "<"),
+    "ppc": (0x12, False, ">"),
+}
+MH_OBJECT, LC_SEGMENT, LC_SEGMENT_64 = 0x1, 0x1, 0x19
+
+
+def main():
+    if len(sys.argv) != 4 or sys.argv[2] not in ARCHS:
+        sys.exit("usage: gen_text.py SIZE x86_64|arm64|ppc OUTPUT")
+
+    size, (cputype, is_64, order), path = int(sys.argv[1]), ARCHS[sys.argv[2]], sys.argv[3]
+    text = random.Random(size).randbytes(size)
+
+    if is_64:
+        sizeofcmds = 72 + 80
+        offset = 32 + sizeofcmds
+        header = struct.pack(order + "IiiIIII4x", 0xfeedfacf, cputype, 0, MH_OBJECT, 1, sizeofcmds, 0)
+        segment = struct.pack(order + "II16sQQQQiiII", LC_SEGMENT_64, sizeofcmds, b"", 0, size, offset, size, 7, 7, 1, 0)
+        section = struct.pack(order + "16s16sQQIIIIIIII", b"__text", b"__TEXT", 0x1000, size, offset, 0, 0, 0, 0, 0, 0, 0)
+    else:
+        sizeofcmds = 56 + 68
+        offset = 28 + sizeofcmds
+        header = struct.pack(order + "IiiIIII", 0xfeedface, cputype, 0, MH_OBJECT, 1, sizeofcmds, 0)
+        segment = struct.pack(order + "II16sIIIIiiII", LC_SEGMENT, sizeofcmds, b"", 0, size, offset, size, 7, 7, 1, 0)
+        section = struct.pack(order + "16s16sIIIIIIIII", b"__text", b"__TEXT", 0x1000, size, offset, 0, 0, 0, 0, 0, 0)
+
+    with open(path, "wb") as out:
+        out.write(header + segment + section + text)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,106 @@
+/*
+   Counts the symbols nm would list in each file, either in process through libofile or by running nm on each file and
+   reading its output, which is what tools had to do before the library. Used by benchmark.sh:
+
+       ofile_client lib FILE...
+       ofile_client exec NM FILE...
+*/
+
+#include "../src/ofile.h"
+#include <mach-o/nlist.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+static void
+report (const t_of_error *error) {
+
+    const char *text = of_strerror(error->errcode);
+
+    if (error->errcode == 0 && error->sys_errno != 0) text = strerror(error->sys_errno);
+    fprintf(stderr, "%s: %.*s: %s\n", error->path, (int)error->member_length, error->member ? error->member : "",
+            text ? text : "unknown error");
+}
+
+static unsigned long
+count_lib (const char *path) {
+
+    t_of_file       *file;
+    t_of_object     object;
+    t_of_error      error;
+    unsigned long   count = 0;
+    int             next;
+
+    if (of_open(path, &file, &error) != EXIT_SUCCESS) return report(&error), 0;
+    while ((next = of_next_object(file, &object, &error)) != OF_END) {
+
+        t_of_cursor cursor = {0};
+        t_of_symbol symbol;
+
+        if (next == OF_ERROR) {
+
+            report(&error);
+            continue;
+        }
+
+        while ((next = of_next_symbol(&object, &cursor, &symbol, &error)) == OF_NEXT)
+            if ((symbol.type & N_STAB) == 0) count++;
+        if (next == OF_ERROR) report(&error);
+    }
+
+    of_close(file);
+    return count;
+}
+
+static unsigned long
+count_exec (const char *nm, const char *path) {
+
+    int             fds[2];
+    char            buffer[1 << 16];
+    unsigned long   count = 0;
+    pid_t           pid;
+
+    /* Symbol lines are the ones holding a type letter between two spaces, headers and blank lines don't. */
+    if (pipe(fds) == -1 || (pid = fork()) == -1) return 0;
+    if (pid == 0) {
+
+        dup2(fds[1], STDOUT_FILENO);
+        close(fds[0]);
+        close(fds[1]);
+        execl(nm, nm, "-p", path, (char *)NULL);
+        _exit(127);
+    }
+
+    close(fds[1]);
+
+    FILE *output = fdopen(fds[0], "r");
+
+    while (output != NULL && fgets(buffer, sizeof buffer, output) != NULL) {
+
+        const char *type = strchr(buffer, ' ');
+        if (type != NULL && type[1] != '\0' && type[2] == ' ') count++;
+    }
+
+    if (output != NULL) fclose(output);
+    waitpid(pid, NULL, 0);
+    return count;
+}
+
+int
+main (int argc, const char **argv) {
+
+    unsigned long   total = 0;
+    const bool      exec = argc > 2 && strcmp(argv[1], "exec") == 0;
+
+    if (argc < 3 || (exec == false && strcmp(argv[1], "lib") != 0)) {
+
+        fprintf(stderr, "usage: %s lib FILE... | exec NM FILE...\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    for (int k = exec ? 3 : 2; k < argc; k++) total += exec ? count_exec(argv[2], argv[k]) : count_lib(argv[k]);
+    printf("%lu\n", total);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,40 @@
+#!/usr/bin/env python3
+"""Send requests read from stdin, one per line, to an ft_nm/ft_otool --serve socket and print the responses."""
+
+import socket
+import sys
+
+
+def read_exactly(stream, size):
+    data = stream.read(size)
+    if len(data) != size:
+        sys.exit("serve_client.py: connection closed by the server")
+    return data
+
+
+def main():
+    if len(sys.argv) != 2:
+        sys.exit("usage: serve_client.py SOCKET < requests")
+
+    client = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+    client.connect(sys.argv[1])
+    stream = client.makefile("rwb")
+
+    # Each response is "status stdout-size stderr-size\n", followed by both outputs.
+    retcode = 0
+    for request in sys.stdin.buffer:
+        stream.write(request if request.endswith(b"\n") else request + b"\n")
+        stream.flush()
+        header = stream.readline().split()
+        if len(header) != 3:
+            sys.exit("serve_client.py: malformed response")
+        status, outsize, errsize = (int(field) for field in header)
+        sys.stdout.buffer.write(read_exactly(stream, outsize))
+        sys.stderr.buffer.write(read_exactly(stream, errsize))
+        retcode |= status
+
+    sys.exit(retcode)
+
+
+if __name__ == "__main__":
+    main()
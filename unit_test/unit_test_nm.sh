@@ -54,3 +54,267 @@ do;
 	fi
 done;
 
+echo "\x1b[33;1mtests for nm, --jobs against a single job\x1b[0m";
+../ft_nm ./valid_binaries/*/* > a1 2>&1;
+../ft_nm --jobs 4 ./valid_binaries/*/* > a2 2>&1;
+diff a1 a2 > result;
+if (( $? != 0 ))
+	then echo "diff with --jobs 4";
+fi
+../ft_nm --arch all ./valid_binaries/*/* ./corrupted_binaries/* > a1 2>&1;
+../ft_nm --arch all --jobs 4 ./valid_binaries/*/* ./corrupted_binaries/* > a2 2>&1;
+diff a1 a2 > result;
+if (( $? != 0 ))
+	then echo "diff with --jobs 4, errors and output merged";
+fi
+
+echo "\x1b[33;1mtests for nm, fat slices on several jobs\x1b[0m";
+for file in ./valid_binaries/fat*/*;
+do;
+	../ft_nm -n --arch all $file > a1 2>&1;
+	../ft_nm -n --arch all --jobs 4 $file > a2 2>&1;
+	diff a1 a2 > result;
+	if (( $? != 0 ))
+		then echo "diff in file $file:";
+	fi
+done;
+
+echo "\x1b[33;1mtests for nm, archive members on several jobs\x1b[0m";
+for file in ./valid_binaries/lib_stat/*;
+do;
+	../ft_nm $file > a1 2>&1;
+	../ft_nm --jobs 4 $file > a2 2>&1;
+	diff a1 a2 > result;
+	if (( $? != 0 ))
+		then echo "diff in file $file:";
+	fi
+done;
+
+echo "\x1b[33;1mtests for nm, --defines against the full listing\x1b[0m";
+TMP=$(mktemp -d);
+for k in {1..100}; do; ./gen_symtab.py 200 $TMP/member_$k.o; done;
+ar -rcs $TMP/defines.a $TMP/member_*.o 2> /dev/null;
+for file in ./valid_binaries/64/* ./valid_binaries/lib_stat/* $TMP/defines.a;
+do;
+	symbol=$(../ft_nm -gU $file | awk 'NF == 3 && $2 != "C" { print $3; exit }');
+	../ft_nm --defines $symbol $file > a1 2>&1;
+	../ft_nm -U $file | awk -v symbol=$symbol '/:$/ { member = $0 } NF == 3 && $3 == symbol \
+		{ if (member != "") print "\n" member; print }' > a2;
+	diff a1 a2 > result;
+	if (( $? != 0 ))
+		then echo "diff in file $file:";
+	fi
+done;
+rm -rf $TMP;
+
+echo "\x1b[33;1mtests for nm, --serve against one process per file\x1b[0m";
+rm -f requests a1;
+for file in ./valid_binaries/*/*;
+do;
+	echo "-n --jobs 2 $file" >> requests;
+	../ft_nm -n $file > out 2> err;
+	echo "$? $(wc -c < out | tr -d ' ') $(wc -c < err | tr -d ' ')" >> a1;
+	cat out err >> a1;
+done;
+echo "--prefetch 2 ./valid_binaries/64/global" >> requests;
+echo "1 0 49\n../ft_nm: --prefetch can't be given in a request" >> a1;
+echo "--cache ./cache ./valid_binaries/64/global" >> requests;
+echo "1 0 46\n../ft_nm: --cache can't be given in a request" >> a1;
+../ft_nm --serve - < requests > a2;
+diff a1 a2 > result;
+if (( $? != 0 ))
+	then echo "diff with --serve";
+fi
+TMP=$(mktemp -d);
+grep -v -e "--prefetch" -e "--cache" requests > $TMP/requests;
+for file in ./valid_binaries/*/*; do; ../ft_nm -n $file; done > a1 2> /dev/null;
+../ft_nm --serve $TMP/nm.sock & SERVER=$!;
+sleep 0.5;
+sleep 5 | ./serve_client.py $TMP/nm.sock > /dev/null 2>&1 & IDLE=$!;
+./serve_client.py $TMP/nm.sock < $TMP/requests > a2 2> /dev/null & CLIENT=$!;
+sleep 2;
+kill $SERVER;
+wait $CLIENT $IDLE;
+diff a1 a2 > result;
+if (( $? != 0 ))
+	then echo "diff with --serve on a socket next to an idle client";
+fi
+rm -rf $TMP;
+rm -f requests out err;
+
+echo "\x1b[33;1mtests for nm, --cache cold and warm against no cache\x1b[0m";
+TMP=$(mktemp -d);
+for file in ./valid_binaries/*/*;
+do;
+	../ft_nm -n --arch all $file > a1 2>&1;
+	../ft_nm -n --arch all --cache $TMP $file > a2 2>&1;
+	diff a1 a2 > result;
+	if (( $? != 0 ))
+		then echo "diff in file $file, cold cache:";
+	fi
+	../ft_nm -n --arch all --cache $TMP $file > a2 2>&1;
+	diff a1 a2 > result;
+	if (( $? != 0 ))
+		then echo "diff in file $file, warm cache:";
+	fi
+done;
+rm -rf $TMP;
+
+echo "\x1b[33;1mtests for nm, -g and all archs\x1b[0m";
+for file in ./valid_binaries/*/*;
+do;
+	../ft_nm -g --arch all $file > a1;
+	nm -g -arch all $file > a2;
+	diff a1 a2 > result;
+	if (( $? != 0 ))
+		then echo "diff in file $file:";
+	fi
+done;
+
+echo "\x1b[33;1mtests for nm, errors with -g, -u and -U against the full listing\x1b[0m";
+for file in ./corrupted_binaries/*;
+do;
+	../ft_nm --arch all $file 2> a1 > /dev/null;
+	for opt in -g -u -U;
+	do;
+		../ft_nm $opt --arch all $file 2> a2 > /dev/null;
+		diff a1 a2 > result;
+		if (( $? != 0 ))
+			then echo "diff in file $file with $opt:";
+		fi
+	done;
+done;
+
+echo "\x1b[33;1mtests for nm, --exports against the external symbols\x1b[0m";
+for file in ./valid_binaries/fat_lib/* ./valid_binaries/64/64_lib_dynamic_*;
+do;
+	../ft_nm --exports -j --arch all $file > a1 2>&1;
+	../ft_nm -gUj --arch all $file > a2 2>&1;
+	diff a1 a2 > result;
+	if (( $? != 0 ))
+		then echo "diff in file $file:";
+	fi
+done;
+
+echo "\x1b[33;1mtests for nm, large symbol tables sorted on several threads\x1b[0m";
+TMP=$(mktemp -d);
+./gen_symtab.py 200000 $TMP/large.o;
+for opt in "" "-n" "-r" "-nr";
+do;
+	../ft_nm $=opt $TMP/large.o > a1 2>&1;
+	../ft_nm $=opt --jobs 4 $TMP/large.o > a2 2>&1;
+	diff a1 a2 > result;
+	if (( $? != 0 ))
+		then echo "diff with options \"$opt\":";
+	fi
+done;
+rm -rf $TMP;
+
+echo "\x1b[33;1mtests for nm, -R against the files listed in name order\x1b[0m";
+../ft_nm $(find ./valid_binaries -type f | LC_ALL=C sort) > a1 2>&1;
+for opt in "" "--jobs 4";
+do;
+	../ft_nm $=opt -R ./valid_binaries > a2 2>&1;
+	diff a1 a2 > result;
+	if (( $? != 0 ))
+		then echo "diff with -R $opt";
+	fi
+done;
+
+echo "\x1b[33;1mtests for nm, --match against the full listing\x1b[0m";
+for file in ./valid_binaries/32/* ./valid_binaries/64/*;
+do;
+	../ft_nm -j --match _m --match='*alloc*' $file > a1 2>&1;
+	../ft_nm -j $file | grep -e '^_m' -e 'alloc' > a2;
+	diff a1 a2 > result;
+	if (( $? != 0 ))
+		then echo "diff in file $file:";
+	fi
+done;
+
+echo "\x1b[33;1mtests for nm, files read ahead against --prefetch 0\x1b[0m";
+../ft_nm --prefetch 0 ./valid_binaries/*/* ./corrupted_binaries/* > a1 2> e1;
+for opt in "" "--prefetch 2" "--prefetch 2 --jobs 4";
+do;
+	../ft_nm $=opt ./valid_binaries/*/* ./corrupted_binaries/* > a2 2> e2;
+	diff a1 a2 > result && diff e1 e2 >> result;
+	if (( $? != 0 ))
+		then echo "diff with \"$opt\"";
+	fi
+done;
+rm -f e1 e2;
+
+echo "\x1b[33;1mtests for nm, FIFOs and stdin next to files read ahead\x1b[0m";
+TMP=$(mktemp -d)
+mkfifo $TMP/fifo;
+../ft_nm ./valid_binaries/32/32_exe_hard ./valid_binaries/64/64_bundle | sed "s|./valid_binaries/64/64_bundle|$TMP/fifo|" > a1 2>&1;
+cat ./valid_binaries/64/64_bundle > $TMP/fifo &
+../ft_nm ./valid_binaries/32/32_exe_hard $TMP/fifo > a2 2>&1;
+wait;
+diff a1 a2 > result;
+if (( $? != 0 ))
+	then echo "diff with a FIFO";
+fi
+../ft_nm ./valid_binaries/32/32_exe_hard ./valid_binaries/64/64_bundle | sed "s|./valid_binaries/64/64_bundle|-|" > a1 2>&1;
+cp ./valid_binaries/32/32_exe_hard ./-;
+cat ./valid_binaries/64/64_bundle | ../ft_nm ./valid_binaries/32/32_exe_hard - > a2 2>&1;
+rm -f ./-;
+diff a1 a2 > result;
+if (( $? != 0 ))
+	then echo "diff with stdin next to a file named -";
+fi
+printf '\xcf\xfa\xed\xfe\x07\x00\x00\x01\x03\x00' > $TMP/short.o;
+echo "symdef" > $TMP/symdef;
+ar -rc $TMP/short.a $TMP/symdef $TMP/short.o 2> /dev/null;
+printf '\xca\xfe\xba\xbe\x00\x00\x00\x01\x01\x00\x00\x07\x00\x00\x00\x03\x00\x00\x10\x00\x00\x00\x00\x26' > $TMP/short_fat;
+printf '\x00\x00\x00\x0c' >> $TMP/short_fat;
+head -c 4068 /dev/zero >> $TMP/short_fat;
+cat $TMP/short.a >> $TMP/short_fat;
+for file in ./valid_binaries/*/* ./corrupted_binaries/* $TMP/short.a $TMP/short_fat;
+do;
+	../ft_nm --arch all $file 2>&1 | sed "s|$file|-|" > a1;
+	cat $file | ../ft_nm --arch all - > a2 2>&1;
+	diff a1 a2 > result;
+	if (( $? != 0 ))
+		then echo "diff with $file streamed through stdin";
+	fi
+done;
+rm -rf $TMP;
+
+echo "\x1b[33;1mtests for nm, byte-swapped symbol tables vs native ones\x1b[0m";
+TMP=$(mktemp -d)
+for pair in "ppc i386" "ppc64 x86_64";
+do;
+	for kind in "" "dylib";
+	do;
+		for arch in $=pair; do; ./gen_symtab.py 5000 $TMP/$arch $arch $kind; done;
+		for opt in "" "-n" "-g" "-u" "-U" "-p" "-a" "-n -r";
+		do;
+			../ft_nm $=opt $TMP/${pair% *} > a1 2>&1;
+			../ft_nm $=opt $TMP/${pair#* } > a2 2>&1;
+			diff a1 a2 > result;
+			if (( $? != 0 ))
+				then echo "diff between ${pair% *} and ${pair#* } $kind with \"$opt\"";
+			fi
+			FT_NM_SCALAR=1 ../ft_nm $=opt $TMP/${pair% *} > a2 2>&1;
+			diff a1 a2 > result;
+			if (( $? != 0 ))
+				then echo "diff between SIMD and scalar swaps of ${pair% *} $kind with \"$opt\"";
+			fi
+		done;
+	done;
+done;
+rm -rf $TMP;
+
+echo "\x1b[33;1mtests for nm, --dedup against the full listing\x1b[0m";
+../ft_nm --arch all ./valid_binaries/*/* ./valid_binaries/*/* > a1 2> e1;
+for opt in "" "--jobs 4";
+do;
+	../ft_nm --dedup --arch all $=opt ./valid_binaries/*/* ./valid_binaries/*/* > a2 2> e2;
+	grep -v -- "--dedup:" e2 > e3;
+	diff a1 a2 > result && diff e1 e3 >> result;
+	if (( $? != 0 ))
+		then echo "diff with --dedup $opt";
+	fi
+done;
+rm -f e1 e2 e3;
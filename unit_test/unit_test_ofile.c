@@ -0,0 +1,179 @@
+/*
+   Feeds libofile small files built in memory, each broken in one way, and some of the corrupted binaries, and checks
+   the iterators report the error nm and otool would. Prints the cases that don't, and exits with a failure if there
+   are any. Used by unit_test_ofile.sh, from the directory the binaries are in.
+*/
+
+#include "../src/ofile.h"
+#include <ar.h>
+#include <mach-o/fat.h>
+#include <mach-o/loader.h>
+#include <mach-o/nlist.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define OBJECT_SIZE 80
+#define BUFF_SIZE 4096
+#define NO_ERROR -1
+#define WRONG_SYMBOL -2
+
+typedef struct          s_case {
+    const char          *name;
+    size_t              (*build)(char *buff);
+    int                 errcode;
+    bool                member;
+}                       t_case;
+
+static size_t
+object (char *buff, bool terminated, uint32_t nsyms) {
+
+    const struct mach_header_64     header = {
+            .magic = MH_MAGIC_64,
+            .cputype = CPU_TYPE_X86_64,
+            .cpusubtype = CPU_SUBTYPE_X86_64_ALL,
+            .filetype = MH_OBJECT,
+            .ncmds = 1,
+            .sizeofcmds = sizeof(struct symtab_command)
+    };
+    const struct symtab_command     symtab = {
+            .cmd = LC_SYMTAB,
+            .cmdsize = sizeof symtab,
+            .symoff = sizeof header + sizeof symtab,
+            .nsyms = nsyms,
+            .stroff = sizeof header + sizeof symtab + sizeof(struct nlist_64),
+            .strsize = terminated ? 8 : 6
+    };
+    const struct nlist_64           nlist = {.n_un.n_strx = 1, .n_type = N_SECT | N_EXT, .n_sect = 1};
+
+    /*
+       A single symbol, whose name is the last one of the string table, cut before its NUL when it isn't terminated.
+       Any other symbol the table announces would be past the end of the file.
+    */
+
+    memset(buff, 0, OBJECT_SIZE);
+    memcpy(buff, &header, sizeof header);
+    memcpy(buff + sizeof header, &symtab, sizeof symtab);
+    memcpy(buff + symtab.symoff, &nlist, sizeof nlist);
+    memcpy(buff + symtab.stroff, "\0_main\0", 8);
+    return symtab.stroff + symtab.strsize;
+}
+
+static size_t
+archive (char *buff, size_t size, const char *fmag) {
+
+    char header[sizeof(struct ar_hdr) + 1];
+
+    /* One member, announcing the given size, after the magic and a header with the given terminator. */
+    memcpy(buff, ARMAG, SARMAG);
+    snprintf(header, sizeof header, "%-16s%-12d%-6d%-6d%-8s%-10zu%.2s", "member.o", 0, 0, 0, "100644", size, fmag);
+    memcpy(buff + SARMAG, header, sizeof(struct ar_hdr));
+    return SARMAG + sizeof(struct ar_hdr) + object(buff + SARMAG + sizeof(struct ar_hdr), true, 1);
+}
+
+static void
+big_endian (char *buff, uint32_t value) {
+
+    for (int k = 0; k < 4; k++) buff[k] = (char)(value >> (24 - 8 * k));
+}
+
+static size_t
+fat (char *buff, uint32_t offset, cpu_type_t cputype) {
+
+    /* Fat headers are big-endian. A single slice of the given architecture at the given offset. */
+    memset(buff, 0, 4096);
+    big_endian(buff, FAT_MAGIC);
+    big_endian(buff + 4, 1);
+    big_endian(buff + 8, (uint32_t)cputype);
+    big_endian(buff + 12, CPU_SUBTYPE_X86_64_ALL);
+    big_endian(buff + 16, offset);
+    big_endian(buff + 20, OBJECT_SIZE);
+    big_endian(buff + 24, 12);
+    return 4096 + object(buff + 4096, true, 1);
+}
+
+static size_t valid_object (char *buff) { return object(buff, true, 1); }
+static size_t unterminated_name (char *buff) { return object(buff, false, 1); }
+static size_t truncated_symtab (char *buff) { return object(buff, true, 2); }
+static size_t valid_archive (char *buff) { return archive(buff, OBJECT_SIZE, ARFMAG); }
+static size_t truncated_member (char *buff) { return archive(buff, OBJECT_SIZE + 100, ARFMAG); }
+static size_t bad_fmag (char *buff) { return archive(buff, OBJECT_SIZE, "`x"); }
+static size_t valid_fat (char *buff) { return fat(buff, 4096, CPU_TYPE_X86_64); }
+static size_t fat_past_end (char *buff) { return fat(buff, 8192, CPU_TYPE_X86_64); }
+static size_t unknown_arch (char *buff) { return fat(buff, 4096, 0); }
+
+static int
+first_error (const t_case *test, char *buff, t_of_error *error) {
+
+    t_of_file       *file;
+    t_of_object     object;
+    int             next;
+    int             errcode = NO_ERROR;
+
+    /*
+       Walks every object and symbol, and returns the first error, or NO_ERROR, as OF_E_RRNO is 0. Cases without a
+       builder are files, whose symbols aren't checked.
+    */
+
+    if ((test->build != NULL ? of_open_memory(buff, test->build(buff), test->name, &file, error)
+        : of_open(test->name, &file, error)) != EXIT_SUCCESS) return error->errcode;
+    while (errcode == NO_ERROR && (next = of_next_object(file, &object, error)) != OF_END) {
+
+        t_of_cursor cursor = {0};
+        t_of_symbol symbol;
+
+        if (next == OF_ERROR) errcode = error->errcode;
+        while (errcode == NO_ERROR && (next = of_next_symbol(&object, &cursor, &symbol, error)) == OF_NEXT)
+            if (test->build != NULL && (symbol.length != 5 || memcmp(symbol.name, "_main", 5) != 0))
+                errcode = WRONG_SYMBOL;
+        if (errcode == NO_ERROR && next == OF_ERROR) errcode = error->errcode;
+    }
+
+    of_close(file);
+    return errcode;
+}
+
+int
+main (void) {
+
+    static const t_case cases[] = {
+            {"valid object", valid_object, NO_ERROR, false},
+            {"symbol name not NUL-terminated", unterminated_name, OF_E_SYMNAME, false},
+            {"symbol table past the end of the file", truncated_symtab, OF_E_RRNO, false},
+            {"valid archive", valid_archive, NO_ERROR, false},
+            {"truncated archive member", truncated_member, OF_E_AROFFSET, true},
+            {"bad ar_fmag", bad_fmag, OF_E_ARFMAG, true},
+            {"valid fat file", valid_fat, NO_ERROR, false},
+            {"fat slice past the end of the file", fat_past_end, OF_E_FATOFF, false},
+            {"fat slice of an unknown architecture", unknown_arch, OF_E_AROVERLAP, false},
+            {"corrupted_binaries/audiodevice_arch_plus_1", NULL, OF_E_AROVERLAP, false},
+            {"corrupted_binaries/audiodevice_arch_plus_2", NULL, OF_E_AROVERLAP, false},
+            {"corrupted_binaries/audiodevice_arch_plus_10", NULL, OF_E_AROVERLAP, false}
+    };
+    static char         buff[BUFF_SIZE + OBJECT_SIZE];
+    int                 retcode = EXIT_SUCCESS;
+
+    for (size_t k = 0; k < sizeof cases / sizeof *cases; k++) {
+
+        t_of_error  error;
+        const int   errcode = first_error(&cases[k], buff, &error);
+
+        if (errcode != cases[k].errcode) {
+
+            printf("%s: expected %s, got %s\n", cases[k].name,
+                    cases[k].errcode >= 0 ? of_strerror(cases[k].errcode) : "no error",
+                    errcode >= 0 ? of_strerror(errcode) : errcode == WRONG_SYMBOL ? "wrong symbol" : "no error");
+            retcode = EXIT_FAILURE;
+        }
+
+        /* Errors in a member name it from the file itself, the name in the header the iterator read. */
+        if (cases[k].member && (error.member != buff + SARMAG || error.member_length < 8
+            || memcmp(error.member, "member.o", 8) != 0)) {
+
+            printf("%s: the error doesn't name the member from the file\n", cases[k].name);
+            retcode = EXIT_FAILURE;
+        }
+    }
+
+    return retcode;
+}
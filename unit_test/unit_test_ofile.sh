@@ -0,0 +1,9 @@
+#!/bin/zsh
+echo "\x1b[33;1mtests for libofile, error paths\x1b[0m";
+TMP=$(mktemp -d)
+gcc -I ../libft/include unit_test_ofile.c ../libofile.a -L ../libft -lft -lpthread -o $TMP/unit_test_ofile;
+$TMP/unit_test_ofile;
+if (( $? != 0 ))
+	then echo "libofile errors differ";
+fi
+rm -rf $TMP;
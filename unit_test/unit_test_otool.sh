@@ -54,3 +54,132 @@ do;
 	fi
 done;
 
+echo "\x1b[33;1mtests for otool, --jobs against a single job\x1b[0m";
+../ft_otool -dht ./valid_binaries/*/* > a1 2>&1;
+../ft_otool -dht --jobs 4 ./valid_binaries/*/* > a2 2>&1;
+diff a1 a2 > result;
+if (( $? != 0 ))
+	then echo "diff with --jobs 4";
+fi
+
+echo "\x1b[33;1mtests for otool, fat slices on several jobs\x1b[0m";
+for file in ./valid_binaries/fat*/*;
+do;
+	../ft_otool -dht --arch all $file > a1 2>&1;
+	../ft_otool -dht --arch all --jobs 4 $file > a2 2>&1;
+	diff a1 a2 > result;
+	if (( $? != 0 ))
+		then echo "diff in file $file:";
+	fi
+done;
+
+echo "\x1b[33;1mtests for otool, archive members on several jobs\x1b[0m";
+for file in ./valid_binaries/lib_stat/*;
+do;
+	../ft_otool -dht $file > a1 2>&1;
+	../ft_otool -dht --jobs 4 $file > a2 2>&1;
+	diff a1 a2 > result;
+	if (( $? != 0 ))
+		then echo "diff in file $file:";
+	fi
+done;
+
+echo "\x1b[33;1mtests for otool, --cache cold and warm against no cache\x1b[0m";
+TMP=$(mktemp -d);
+for file in ./valid_binaries/*/*;
+do;
+	../ft_otool -dht --arch all $file > a1 2>&1;
+	../ft_otool -dht --arch all --cache $TMP $file > a2 2>&1;
+	diff a1 a2 > result;
+	if (( $? != 0 ))
+		then echo "diff in file $file, cold cache:";
+	fi
+	../ft_otool -dht --arch all --cache $TMP $file > a2 2>&1;
+	diff a1 a2 > result;
+	if (( $? != 0 ))
+		then echo "diff in file $file, warm cache:";
+	fi
+done;
+rm -rf $TMP;
+
+echo "\x1b[33;1mtests for otool, vector hexdump against the scalar one\x1b[0m";
+for file in ./valid_binaries/*/*;
+do;
+	FT_OTOOL_SCALAR=1 ../ft_otool -dt --arch all $file > a1 2>&1;
+	../ft_otool -dt --arch all $file > a2 2>&1;
+	diff a1 a2 > result;
+	if (( $? != 0 ))
+		then echo "diff in file $file:";
+	fi
+done;
+
+echo "\x1b[33;1mtests for otool, -R against the files listed in name order\x1b[0m";
+../ft_otool -t $(find ./valid_binaries -type f | LC_ALL=C sort) > a1 2>&1;
+for opt in "" "--jobs 4";
+do;
+	../ft_otool -t $=opt -R ./valid_binaries > a2 2>&1;
+	diff a1 a2 > result;
+	if (( $? != 0 ))
+		then echo "diff with -R $opt";
+	fi
+done;
+
+echo "\x1b[33;1mtests for otool, large sections dumped on several threads\x1b[0m";
+TMP=$(mktemp -d);
+for arch in x86_64 arm64 ppc;
+do;
+	./gen_text.py $((4 << 20)) $arch $TMP/text_$arch;
+	../ft_otool -t $TMP/text_$arch > a1 2>&1;
+	../ft_otool -t --jobs 2 $TMP/text_$arch > a2 2>&1;
+	diff a1 a2 > result;
+	if (( $? != 0 ))
+		then echo "diff for $arch:";
+	fi
+done;
+rm -rf $TMP;
+
+echo "\x1b[33;1mtests for otool, files read ahead against --prefetch 0\x1b[0m";
+../ft_otool -dht --prefetch 0 ./valid_binaries/*/* ./corrupted_binaries/* > a1 2> e1;
+for opt in "" "--prefetch 2" "--prefetch 2 --jobs 4";
+do;
+	../ft_otool -dht $=opt ./valid_binaries/*/* ./corrupted_binaries/* > a2 2> e2;
+	diff a1 a2 > result && diff e1 e2 >> result;
+	if (( $? != 0 ))
+		then echo "diff with \"$opt\"";
+	fi
+done;
+rm -f e1 e2;
+
+
+echo "\x1b[33;1mtests for otool, --probe against -h\x1b[0m";
+for file in ./valid_binaries/*/* ./corrupted_binaries/*;
+do;
+	for opt in "" "--arch all";
+	do;
+		../ft_otool -h $=opt $file > a1 2>&1;
+		../ft_otool --probe $=opt $file > a2 2>&1;
+		diff a1 a2 > result;
+		if (( $? != 0 ))
+			then echo "diff in file $file with \"$opt\":";
+		fi
+	done;
+done;
+../ft_otool -h --jobs 4 ./valid_binaries/*/* > a1 2>&1;
+../ft_otool --probe --jobs 4 ./valid_binaries/*/* > a2 2>&1;
+diff a1 a2 > result;
+if (( $? != 0 ))
+	then echo "diff with --jobs 4";
+fi
+
+echo "\x1b[33;1mtests for otool, --dedup against the full dump\x1b[0m";
+../ft_otool -dht --arch all ./valid_binaries/*/* ./valid_binaries/*/* > a1 2> e1;
+for opt in "" "--jobs 4";
+do;
+	../ft_otool -dht --dedup --arch all $=opt ./valid_binaries/*/* ./valid_binaries/*/* > a2 2> e2;
+	grep -v -- "--dedup:" e2 > e3;
+	diff a1 a2 > result && diff e1 e3 >> result;
+	if (( $? != 0 ))
+		then echo "diff with --dedup $opt";
+	fi
+done;
+rm -f e1 e2 e3;